@@ -0,0 +1,363 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Network.h"
+
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+namespace Synet
+{
+    template <class T> class BatchingExecutor
+    {
+    public:
+        typedef Synet::Network<T> Network;
+        typedef Synet::Tensor<T> Tensor;
+        typedef std::vector<Tensor> Tensors;
+
+        BatchingExecutor()
+            : _maxBatch(0)
+            , _timeout(0)
+            , _size(0)
+            , _stop(false)
+        {
+        }
+
+        ~BatchingExecutor()
+        {
+            Stop();
+        }
+
+        bool Init(const Network & network, size_t maxBatch, size_t timeout)
+        {
+            Stop();
+            _networks.clear();
+            if (maxBatch == 0 || network.Src().size() != 1 || network.Src()[0]->Count() != 4)
+                return false;
+            if (!network.Clone(_origin))
+                return false;
+            _maxBatch = maxBatch;
+            _timeout = timeout;
+            _shape = _origin.NchwShape();
+            if (Get(1) == NULL || Get(_maxBatch) == NULL)
+            {
+                std::cout << "BatchingExecutor: can't reshape network to batch " << _maxBatch << " !" << std::endl;
+                _networks.clear();
+                return false;
+            }
+            if (!InitSplits())
+            {
+                _networks.clear();
+                return false;
+            }
+            _size = Get(1)->Src()[0]->Size();
+            _stop = false;
+            _thread = std::thread(&BatchingExecutor::Run, this);
+            return true;
+        }
+
+        void Stop()
+        {
+            if (_thread.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _wakeup.notify_all();
+                _thread.join();
+            }
+        }
+
+        size_t MaxBatch() const
+        {
+            return _maxBatch;
+        }
+
+        bool Forward(const T * src, size_t size, Tensors & dst)
+        {
+            if (size != _size)
+            {
+                std::cout << "BatchingExecutor: input size " << size << " != " << _size << " !" << std::endl;
+                return false;
+            }
+            Request request;
+            request.data = src;
+            request.dst = &dst;
+            return Execute(request);
+        }
+
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+        bool Forward(const View & view, const Floats & lower, const Floats & upper, Tensors & dst)
+        {
+            Request request;
+            request.view = &view;
+            request.lower = lower;
+            request.upper = upper;
+            request.dst = &dst;
+            return Execute(request);
+        }
+#endif
+
+    private:
+        typedef std::shared_ptr<Network> NetworkPtr;
+        typedef std::map<size_t, NetworkPtr> NetworkMap;
+        typedef std::chrono::steady_clock Clock;
+
+        struct Request
+        {
+            const T * data;
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+            const View * view;
+#endif
+            Floats lower, upper;
+            Tensors * dst;
+            Clock::time_point time;
+            bool done, result;
+
+            Request()
+                : data(NULL)
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+                , view(NULL)
+#endif
+                , dst(NULL)
+                , done(false)
+                , result(false)
+            {
+            }
+
+            bool Compatible(const Request & other) const
+            {
+                return (data == NULL) == (other.data == NULL) && lower == other.lower && upper == other.upper;
+            }
+        };
+        typedef std::vector<Request*> Requests;
+
+        enum SplitType
+        {
+            SplitBatch,
+            SplitImageId,
+        };
+        typedef std::vector<SplitType> SplitTypes;
+
+        Network _origin;
+        NetworkMap _networks;
+        Shape _shape;
+        SplitTypes _splits;
+        size_t _maxBatch, _timeout, _size;
+        bool _stop;
+        std::deque<Request*> _queue;
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _wakeup, _done;
+
+        bool Execute(Request & request)
+        {
+            if (!_thread.joinable())
+                return false;
+            std::unique_lock<std::mutex> lock(_mutex);
+            request.time = Clock::now();
+            _queue.push_back(&request);
+            if (_queue.size() == 1 || _queue.size() >= _maxBatch)
+                _wakeup.notify_one();
+            _done.wait(lock, [&] { return request.done; });
+            return request.result;
+        }
+
+        Network * Get(size_t batch)
+        {
+            typename NetworkMap::iterator it = _networks.find(batch);
+            if (it != _networks.end())
+                return it->second.get();
+            NetworkPtr network(new Network());
+            if (!_origin.Clone(*network) || !network->Reshape(_shape[3], _shape[2], batch))
+                return NULL;
+            _networks[batch] = network;
+            return network.get();
+        }
+
+        bool InitSplits()
+        {
+            const Network & one = *Get(1), & all = *Get(_maxBatch);
+            _splits.resize(one.Dst().size());
+            for (size_t i = 0; i < _splits.size(); ++i)
+            {
+                const Shape & shape = all.Dst()[i]->Shape();
+                if (_maxBatch == 1 || (shape.size() && shape[0] == _maxBatch && one.Dst()[i]->Axis(0) == 1))
+                    _splits[i] = SplitBatch;
+                else if (IsDetectionOutput(one, one.Back()[i]) && shape.size() == 4 && shape[3] == 7)
+                    _splits[i] = SplitImageId;
+                else
+                {
+                    std::cout << "BatchingExecutor: can't split output " << one.Dst()[i]->Name() << " by batch !" << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool IsDetectionOutput(const Network & network, const Layer<T> * layer)
+        {
+            if (layer->Param().type() == LayerTypeStub && layer->Param().src().size() == 1)
+            {
+                for (size_t s = 0; s < network.StageCount(); ++s)
+                    if (network.StageLayer(s)->Param().name() == layer->Param().src()[0])
+                        return network.StageLayer(s)->Param().type() == LayerTypeDetectionOutput;
+            }
+            return layer->Param().type() == LayerTypeDetectionOutput;
+        }
+
+        void Run()
+        {
+            Requests batch;
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                while (!_stop && _queue.size() < _maxBatch)
+                {
+                    if (_queue.empty())
+                        _wakeup.wait(lock);
+                    else if (_wakeup.wait_until(lock, _queue.front()->time + std::chrono::microseconds(_timeout)) == std::cv_status::timeout)
+                        break;
+                }
+                if (_queue.empty())
+                {
+                    if (_stop)
+                        break;
+                    continue;
+                }
+                batch.clear();
+                batch.push_back(_queue.front());
+                _queue.pop_front();
+                for (typename std::deque<Request*>::iterator it = _queue.begin(); it != _queue.end() && batch.size() < _maxBatch;)
+                {
+                    if ((*it)->Compatible(*batch[0]))
+                    {
+                        batch.push_back(*it);
+                        it = _queue.erase(it);
+                    }
+                    else
+                        ++it;
+                }
+                lock.unlock();
+                bool result = Forward(batch);
+                lock.lock();
+                for (size_t i = 0; i < batch.size(); ++i)
+                {
+                    batch[i]->result = result;
+                    batch[i]->done = true;
+                }
+                _done.notify_all();
+            }
+        }
+
+        bool Forward(const Requests & batch)
+        {
+            Network * network = Get(batch.size());
+            if (network == NULL)
+                return false;
+            if (batch[0]->data)
+            {
+                Tensor & src = *network->Src()[0];
+                size_t size = src.Size() / batch.size();
+                for (size_t i = 0; i < batch.size(); ++i)
+                    memcpy(src.CpuData() + i * size, batch[i]->data, size * sizeof(T));
+            }
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+            else
+            {
+                Views views(batch.size());
+                for (size_t i = 0; i < batch.size(); ++i)
+                    views[i] = *batch[i]->view;
+                if (!network->SetInput(views, batch[0]->lower, batch[0]->upper))
+                    return false;
+            }
+#endif
+            network->Forward();
+            const typename Network::TensorPtrs & dst = network->Dst();
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                batch[i]->dst->resize(dst.size());
+                for (size_t j = 0; j < dst.size(); ++j)
+                {
+                    if (_splits[j] == SplitImageId)
+                        SliceImageId(*dst[j], i, batch[i]->dst->at(j));
+                    else
+                        Slice(*dst[j], batch.size(), i, batch[i]->dst->at(j));
+                }
+            }
+            return true;
+        }
+
+        static void Slice(const Tensor & src, size_t batch, size_t index, Tensor & dst)
+        {
+            Shape shape = src.Shape();
+            size_t size = src.Size(), offset = 0;
+            if (shape.size() && shape[0] == batch)
+            {
+                shape[0] = 1;
+                size /= batch;
+                offset = size * index;
+            }
+            switch (src.GetType())
+            {
+            case TensorType32f: dst.As32f().Reshape(shape, 0.0f, src.Format(), src.Name()); break;
+            case TensorType32i: dst.As32i().Reshape(shape, 0, src.Format(), src.Name()); break;
+            case TensorType8i: dst.As8i().Reshape(shape, 0, src.Format(), src.Name()); break;
+            case TensorType8u: dst.As8u().Reshape(shape, 0, src.Format(), src.Name()); break;
+            case TensorType64i: dst.As64i().Reshape(shape, 0, src.Format(), src.Name()); break;
+            default: dst.Clear(); return;
+            }
+            memcpy(dst.RawCpuData(), src.RawCpuData() + offset * src.TypeSize(), size * src.TypeSize());
+        }
+
+        static void SliceImageId(const Tensor & src, size_t index, Tensor & dst)
+        {
+            const T * pSrc = src.CpuData();
+            size_t rows = src.Size() / 7, count = 0;
+            for (size_t r = 0; r < rows; ++r)
+                if (pSrc[r * 7] == T(index))
+                    count++;
+            dst.Reshape(Shp(1, 1, std::max<size_t>(count, 1), 7), T(-1), src.Format(), src.Name());
+            T * pDst = dst.CpuData();
+            pDst[0] = T(0);
+            for (size_t r = 0; r < rows; ++r, pSrc += 7)
+            {
+                if (pSrc[0] == T(index))
+                {
+                    memcpy(pDst, pSrc, 7 * sizeof(T));
+                    pDst[0] = T(0);
+                    pDst += 7;
+                }
+            }
+        }
+    };
+}
@@ -71,6 +71,7 @@
 #include <sstream>
 #include <map>
 #include <set>
+#include <list>
 #include <queue>
 #include <cmath>
 #include <iomanip>
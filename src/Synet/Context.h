@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Synet/Common.h"
+#include "Synet/Utils/Tuning.h"
 
 namespace Synet
 {
@@ -38,16 +39,35 @@ namespace Synet
             PerfomanceLogSubnet,
         };
 
+        enum Profiling
+        {
+            ProfilingEmpty = 0,
+            ProfilingTime,
+            ProfilingCounters,
+        };
+
         PerfomanceLog performanceLog;
+        Profiling profiling;
+        bool memoryPlanning;
+        size_t interOpThreads;
+        size_t reshapeCacheSize;
+        bool autoTuning;
+        String tuningCache;
 
         Options()
         {
             performanceLog = PerfomanceLogEmpty;
+            profiling = ProfilingEmpty;
+            memoryPlanning = false;
+            interOpThreads = 1;
+            reshapeCacheSize = 0;
+            autoTuning = false;
         }
     };
     struct Context
     {
         Options options;
+        TuningCache tuning;
 
         Context()
         {
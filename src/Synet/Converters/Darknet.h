@@ -103,19 +103,7 @@ namespace Synet
             if (!optimizer.Run(holder(), weight))
                 return false;
 
-            if (!holder.Save(dstModelPath, false))
-            {
-                std::cout << "Can't save Synet model '" << dstModelPath << "' !" << std::endl;
-                return false;
-            }
-
-            if (!SaveBinaryData(weight, dstWeightPath))
-            {
-                std::cout << "Can't save Synet weight '" << dstWeightPath << "' !" << std::endl;
-                return false;
-            }
-
-            return true;
+            return SaveSynetModel(holder, weight, dstModelPath, dstWeightPath);
         }
 
     private:
@@ -79,19 +79,7 @@ namespace Synet
             if (version >= 10)
                 dstXml().dst().clear();
 
-            if (!dstXml.Save(dstModel, false))
-            {
-                std::cout << "Can't save Synet model '" << dstModel << "' !" << std::endl;
-                return false;
-            }
-
-            if (!SaveBinaryData(dstBin, dstWeight))
-            {
-                std::cout << "Can't save Synet weight '" << dstWeight << "' !" << std::endl;
-                return false;
-            }
-
-            return true;
+            return SaveSynetModel(dstXml, dstBin, dstModel, dstWeight);
         }
 
     private:
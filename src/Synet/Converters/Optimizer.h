@@ -35,6 +35,10 @@ namespace Synet
         SYNET_PARAM_VALUE(bool, mergeTwoConvolutions, true);
         SYNET_PARAM_VALUE(int, mergeTwoConvolutionsOutputNumMax, 256);
         SYNET_PARAM_VALUE(bool, mergeInt8Convolutions, true);
+        SYNET_PARAM_VALUE(bool, mergeElementwise, true);
+        SYNET_PARAM_VALUE(int, weightAlignment, 64);
+        SYNET_PARAM_VALUE(bool, selectLayout, false);
+        SYNET_PARAM_VALUE(float, layoutPermuteCost, 1.0f);
     };
 
     SYNET_PARAM_HOLDER(OptimizerParamHolder, OptimizerParam, optimizer);
@@ -49,7 +53,9 @@ namespace Synet
 
         bool Run(Synet::NetworkParam & network, Floats & bin)
         {
-            for (int stage = 0; stage < 8; stage++)
+            if (_param.selectLayout() && !SelectLayout(network, bin))
+                return false;
+            for (int stage = 0; stage < 9; stage++)
             {
                 if (!OptimizeLayers(network, bin, stage))
                     return false;
@@ -58,6 +64,8 @@ namespace Synet
                 return false;
             if (!RemoveStub(network))
                 return false;
+            if (!AlignWeight(network, bin))
+                return false;
             return true;
         }
 
@@ -68,6 +76,18 @@ namespace Synet
         typedef std::vector<LayerType> LayerTypes;
         typedef std::set<String> StringSet;
 
+        struct LayoutTensor
+        {
+            TensorFormat format;
+            bool shaped;
+            double channels, spatial;
+
+            LayoutTensor() : format(TensorFormatUnknown), shaped(false), channels(1.0), spatial(1.0) {}
+
+            double Size() const { return channels * spatial; }
+        };
+        typedef std::map<String, LayoutTensor> LayoutTensors;
+
         const OptimizerParam & _param;
 
         bool OptimizeLayers(Synet::NetworkParam& network, Floats& bin, int stage)
@@ -171,6 +191,12 @@ namespace Synet
                         continue;
                     break;
                 }
+                case 8:
+                {
+                    if (!is8i && MergeElementwise(network, i, merged))
+                        continue;
+                    break;
+                }
                 default:
                     assert(0);
                     return false;
@@ -1449,6 +1475,561 @@ namespace Synet
             return true;
         }
 
+        bool MergeElementwise(const Synet::NetworkParam& network, size_t& index, LayerParams& dst)
+        {
+            const LayerParams& src = network.layers();
+            if (!_param.mergeElementwise() || !IsElementwise(src[index]) || !src[index].parent().empty())
+                return false;
+            StringSet known;
+            known.insert(src[index].src()[0]);
+            size_t end = index;
+            while (end < src.size() && IsElementwise(src[end]) && src[end].parent().empty() && IsKnownSrc(src[end], known))
+                known.insert(src[end++].dst()[0]);
+            for (; end > index + 1; --end)
+            {
+                bool used = false;
+                const String& output = src[end - 1].dst()[0];
+                for (size_t i = index; i < end - 1 && !used; ++i)
+                {
+                    const String& name = src[i].dst()[0];
+                    if (name == output)
+                        continue;
+                    for (size_t d = 0; d < network.dst().size(); ++d)
+                        used = used || network.dst()[d] == name;
+                    for (size_t l = end; l < src.size() && !used; ++l)
+                        for (size_t s = 0; s < src[l].src().size(); ++s)
+                            used = used || src[l].src()[s] == name;
+                }
+                if (!used)
+                    break;
+            }
+            if (end <= index + 1)
+                return false;
+
+            LayerParam layer;
+            layer.type() = LayerTypeElementwise;
+            layer.name() = src[end - 1].name();
+            layer.dst().push_back(src[end - 1].dst()[0]);
+            std::map<String, int> regs;
+            for (size_t i = index; i < end; ++i)
+            {
+                for (size_t s = 0; s < src[i].src().size(); ++s)
+                {
+                    const String& name = src[i].src()[s];
+                    if (regs.find(name) == regs.end())
+                    {
+                        regs[name] = (int)layer.src().size();
+                        layer.src().push_back(name);
+                    }
+                }
+                regs[src[i].dst()[0]] = -1;
+                for (size_t w = 0; w < src[i].weight().size(); ++w)
+                    layer.weight().push_back(src[i].weight()[w]);
+            }
+            regs.clear();
+            for (size_t s = 0; s < layer.src().size(); ++s)
+                regs[layer.src()[s]] = (int)s;
+            int weight = (int)layer.src().size();
+            ElementwiseParam& param = layer.elementwise();
+            for (size_t i = index; i < end; ++i)
+            {
+                Ints args;
+                for (size_t s = 0; s < src[i].src().size(); ++s)
+                    args.push_back(regs[src[i].src()[s]]);
+                int reg = AddElementwiseOps(src[i], args, weight, (int)layer.src().size() + (int)layer.weight().size(), param);
+                regs[src[i].dst()[0]] = reg;
+                weight += (int)src[i].weight().size();
+            }
+            dst.push_back(layer);
+            index = end - 1;
+            return true;
+        }
+
+        bool IsElementwise(const LayerParam& layer) const
+        {
+            if (layer.dst().size() != 1 || layer.src().empty())
+                return false;
+            switch (layer.type())
+            {
+            case LayerTypeElu:
+            case LayerTypeHswish:
+            case LayerTypeMish:
+            case LayerTypePower:
+            case LayerTypeRelu:
+            case LayerTypeRestrictRange:
+            case LayerTypeSigmoid:
+            case LayerTypeSoftplus:
+                return layer.src().size() == 1 && layer.weight().empty();
+            case LayerTypeUnaryOperation:
+                return layer.src().size() == 1 && layer.unaryOperation().type() != UnaryOperationTypeUnknown;
+            case LayerTypeBinaryOperation:
+                return layer.src().size() == 2 && layer.binaryOperation().type() != BinaryOperationTypeUnknown;
+            case LayerTypeEltwise:
+                if (layer.eltwise().operation() == EltwiseOperationTypeProduct && layer.eltwise().coefficients().size())
+                    return false;
+                return layer.src().size() > 1 && (layer.eltwise().coefficients().empty() ||
+                    layer.eltwise().coefficients().size() == layer.src().size());
+            case LayerTypeScale:
+                return layer.src().size() == 1 && layer.weight().size() == (layer.scale().biasTerm() ? 2 : 1);
+            case LayerTypeBias:
+            case LayerTypePrelu:
+                return layer.src().size() == 1 && layer.weight().size() == 1;
+            default:
+                return false;
+            }
+        }
+
+        static bool IsKnownSrc(const LayerParam& layer, const StringSet& known)
+        {
+            for (size_t s = 0; s < layer.src().size(); ++s)
+                if (known.find(layer.src()[s]) == known.end())
+                    return false;
+            return true;
+        }
+
+        int AddElementwiseOps(const LayerParam& layer, const Ints& args, int weight, int first, ElementwiseParam& param)
+        {
+            switch (layer.type())
+            {
+            case LayerTypeElu:
+                return AddElementwiseOp(ElementwiseOpTypeElu, Ints({ args[0] }), Floats({ layer.elu().alpha() }), 1, first, param);
+            case LayerTypeHswish:
+                return AddElementwiseOp(ElementwiseOpTypeHswish, Ints({ args[0] }), Floats({ layer.hswish().shift(), layer.hswish().scale() }), 1, first, param);
+            case LayerTypeMish:
+                return AddElementwiseOp(ElementwiseOpTypeMish, Ints({ args[0] }), Floats({ layer.softplus().threshold() }), 1, first, param);
+            case LayerTypePower:
+                return AddElementwiseOp(ElementwiseOpTypePower, Ints({ args[0] }), Floats({ layer.power().power(), layer.power().scale(), layer.power().shift() }), 1, first, param);
+            case LayerTypeRelu:
+                return AddElementwiseOp(ElementwiseOpTypeRelu, Ints({ args[0] }), Floats({ layer.relu().negativeSlope() }), 1, first, param);
+            case LayerTypeRestrictRange:
+                return AddElementwiseOp(ElementwiseOpTypeRestrictRange, Ints({ args[0] }), Floats({ layer.restrictRange().lower(), layer.restrictRange().upper() }), 1, first, param);
+            case LayerTypeSigmoid:
+                return AddElementwiseOp(ElementwiseOpTypeSigmoid, Ints({ args[0] }), Floats(), 1, first, param);
+            case LayerTypeSoftplus:
+                return AddElementwiseOp(ElementwiseOpTypeSoftplus, Ints({ args[0] }), Floats({ layer.softplus().beta(), layer.softplus().threshold() }), 1, first, param);
+            case LayerTypeUnaryOperation:
+            {
+                ElementwiseOpType type = (ElementwiseOpType)(ElementwiseOpTypeAbs + layer.unaryOperation().type() - UnaryOperationTypeAbs);
+                return AddElementwiseOp(type, Ints({ args[0] }), Floats(), 1, first, param);
+            }
+            case LayerTypeBinaryOperation:
+            {
+                ElementwiseOpType type = layer.binaryOperation().type() == BinaryOperationTypeSub ? ElementwiseOpTypeSub : ElementwiseOpTypeDiv;
+                return AddElementwiseOp(type, args, Floats(), 1, first, param);
+            }
+            case LayerTypeEltwise:
+            {
+                const Floats& coefficients = layer.eltwise().coefficients();
+                ElementwiseOpType type = ElementwiseOpTypeAdd;
+                if (layer.eltwise().operation() == EltwiseOperationTypeProduct)
+                    type = ElementwiseOpTypeMul;
+                else if (layer.eltwise().operation() == EltwiseOperationTypeMax)
+                    type = ElementwiseOpTypeMax;
+                else if (layer.eltwise().operation() == EltwiseOperationTypeMin)
+                    type = ElementwiseOpTypeMin;
+                int reg = args[0];
+                for (size_t i = 1; i < args.size(); ++i)
+                {
+                    Floats floats;
+                    if (type == ElementwiseOpTypeAdd && coefficients.size())
+                        floats = Floats({ i == 1 ? coefficients[0] : 1.0f, coefficients[i] });
+                    reg = AddElementwiseOp(type, Ints({ reg, args[i] }), floats, 1, first, param);
+                }
+                return reg;
+            }
+            case LayerTypeScale:
+            {
+                int reg = AddElementwiseOp(ElementwiseOpTypeMul, Ints({ args[0], weight }), Floats(), layer.scale().axis(), first, param);
+                if (layer.scale().biasTerm())
+                    reg = AddElementwiseOp(ElementwiseOpTypeAdd, Ints({ reg, weight + 1 }), Floats(), layer.scale().axis(), first, param);
+                return reg;
+            }
+            case LayerTypeBias:
+                return AddElementwiseOp(ElementwiseOpTypeAdd, Ints({ args[0], weight }), Floats(), layer.scale().axis(), first, param);
+            case LayerTypePrelu:
+                return AddElementwiseOp(ElementwiseOpTypePrelu, Ints({ args[0], weight }), Floats(), layer.prelu().axis(), first, param);
+            default:
+                assert(0);
+                return -1;
+            }
+        }
+
+        int AddElementwiseOp(ElementwiseOpType type, const Ints& src, const Floats& floats, uint32_t axis, int first, ElementwiseParam& param)
+        {
+            ElementwiseOpParam op;
+            op.type() = type;
+            op.src() = src;
+            op.floats() = floats;
+            op.axis() = axis;
+            param.op().push_back(op);
+            return first + (int)param.op().size() - 1;
+        }
+
+        bool SelectLayout(Synet::NetworkParam& network, Floats& bin)
+        {
+            if (network.quantization().statistics().size())
+                return true;
+            LayerParams layers = network.layers();
+            std::map<String, int> producers;
+            std::map<String, String> current;
+            std::map<size_t, size_t> offsets;
+            StringSet reused;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                LayerParam& layer = layers[i];
+                if (layer.parent().size())
+                    continue;
+                for (size_t s = 0; s < layer.src().size(); ++s)
+                    if (current.find(layer.src()[s]) != current.end())
+                        layer.src()[s] = current[layer.src()[s]];
+                for (size_t d = 0; d < layer.dst().size(); ++d)
+                {
+                    String& dst = layer.dst()[d];
+                    if (producers.find(dst) != producers.end())
+                    {
+                        String name = layer.dst().size() > 1 ? layer.name() + ":" + ValueToString(d) : layer.name();
+                        if (producers.find(name) != producers.end() || HasOutput(network, layer))
+                            return true;
+                        current[dst] = name;
+                        reused.insert(name);
+                        dst = name;
+                    }
+                    producers[dst] = (int)i;
+                }
+                for (size_t w = 0; w < layer.weight().size(); ++w)
+                    offsets[layer.weight()[w].offset()]++;
+            }
+
+            LayoutTensors tensors;
+            Ints region(layers.size(), -1);
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                if (layers[i].parent().size() || !EstimateLayout(layers[i], bin, offsets, tensors))
+                    continue;
+                region[i] = (int)i;
+                for (size_t s = 0; s < layers[i].src().size(); ++s)
+                {
+                    int p = producers[layers[i].src()[s]];
+                    if (region[p] < 0)
+                        continue;
+                    int a = LayoutRegion(region, (int)i), b = LayoutRegion(region, p);
+                    region[Max(a, b)] = Min(a, b);
+                }
+            }
+            for (size_t i = 0; i < layers.size(); ++i)
+                if (region[i] >= 0)
+                    region[i] = LayoutRegion(region, (int)i);
+
+            std::map<String, Ints> users;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                if (layers[i].parent().empty())
+                    for (size_t s = 0; s < layers[i].src().size(); ++s)
+                        users[layers[i].src()[s]].push_back((int)i);
+            }
+            for (size_t d = 0; d < network.dst().size(); ++d)
+                users[network.dst()[d]].push_back(-1);
+            for (StringSet::const_iterator it = reused.begin(); it != reused.end(); ++it)
+                if (users[*it].empty())
+                    return true;
+
+            std::map<int, double> costNchw, costNhwc;
+            StringSet inputs, outputs;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                const LayerParam& layer = layers[i];
+                int r = region[i];
+                if (r < 0)
+                    continue;
+                costNchw[r] += LayoutCost(layer, tensors, TensorFormatNchw);
+                costNhwc[r] += LayoutCost(layer, tensors, TensorFormatNhwc);
+                double& other = tensors[layer.dst()[0]].format == TensorFormatNchw ? costNhwc[r] : costNchw[r];
+                for (size_t s = 0; s < layer.src().size(); ++s)
+                {
+                    const String& src = layer.src()[s];
+                    const LayerParam& producer = layers[producers[src]];
+                    if (region[producers[src]] != r && inputs.insert(ValueToString(r) + ":" + src).second && !IsLayoutPermute(producer))
+                        other += _param.layoutPermuteCost() * tensors[src].Size();
+                }
+                const String& dst = layer.dst()[0];
+                const Ints& used = users[dst];
+                bool output = used.empty(), permuted = true;
+                for (size_t u = 0; u < used.size(); ++u)
+                {
+                    if (used[u] >= 0 && region[used[u]] == r)
+                        continue;
+                    output = true;
+                    permuted = permuted && used[u] >= 0 && IsLayoutPermute(layers[used[u]]);
+                }
+                if (output)
+                {
+                    outputs.insert(dst);
+                    if (!permuted)
+                        other += _param.layoutPermuteCost() * tensors[dst].Size();
+                }
+            }
+
+            std::map<int, TensorFormat> formats;
+            for (std::map<int, double>::iterator it = costNchw.begin(); it != costNchw.end(); ++it)
+            {
+                int r = it->first;
+                if (tensors[layers[r].dst()[0]].format == TensorFormatNchw && costNhwc[r] < costNchw[r])
+                    formats[r] = TensorFormatNhwc;
+                if (tensors[layers[r].dst()[0]].format == TensorFormatNhwc && costNchw[r] < costNhwc[r])
+                    formats[r] = TensorFormatNchw;
+            }
+            if (formats.empty())
+                return true;
+
+            LayerParams selected;
+            std::map<String, String> renamed;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                LayerParam layer = layers[i];
+                int r = region[i];
+                if (formats.find(r) == formats.end())
+                {
+                    selected.push_back(layer);
+                    continue;
+                }
+                TensorFormat format = formats[r], origin = tensors[layer.dst()[0]].format;
+                String suffix = format == TensorFormatNhwc ? "_nhwc" : "_nchw";
+                for (size_t s = 0; s < layer.src().size(); ++s)
+                {
+                    String& src = layer.src()[s];
+                    if (renamed.find(src) == renamed.end())
+                    {
+                        selected.push_back(LayoutPermute(src + suffix, src, src + suffix, format));
+                        renamed[src] = src + suffix;
+                    }
+                    src = renamed[src];
+                }
+                if (layer.type() == LayerTypeConvolution && !ReorderWeight(layer.weight()[0], format, bin))
+                    return false;
+                if (layer.type() == LayerTypeConcat)
+                    layer.concat().axis() = format == TensorFormatNhwc ? 3 : 1;
+                String dst = layer.dst()[0];
+                if (outputs.find(dst) != outputs.end())
+                {
+                    if (layer.name() == dst)
+                        layer.name() = dst + suffix;
+                    layer.dst()[0] = dst + suffix;
+                    selected.push_back(layer);
+                    String back = origin == TensorFormatNhwc ? "_to_nhwc" : "_to_nchw";
+                    selected.push_back(LayoutPermute(dst + back, layer.dst()[0], dst, origin));
+                }
+                else
+                    selected.push_back(layer);
+                renamed[dst] = layer.dst()[0];
+            }
+            for (size_t i = 0; i < selected.size(); ++i)
+            {
+                if (!IsLayoutPermute(selected[i]) || HasOutput(network, selected[i]))
+                    continue;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (selected[j].dst()[0] != selected[i].src()[0] || !IsLayoutPermute(selected[j]) ||
+                        selected[j].permute().format() == selected[i].permute().format())
+                        continue;
+                    Rename(Change(selected[i].dst()[0], selected[j].src()[0]), selected);
+                    selected.erase(selected.begin() + i--);
+                    if (Users(selected[j].dst()[0], selected, 0, "") == 0 && !HasOutput(network, selected[j]))
+                        selected.erase(selected.begin() + j), i--;
+                    break;
+                }
+            }
+            network.layers().swap(selected);
+            return true;
+        }
+
+        bool EstimateLayout(const LayerParam& layer, const Floats& bin, const std::map<size_t, size_t>& offsets, LayoutTensors& tensors) const
+        {
+            LayoutTensor info;
+            bool uniform = true;
+            for (size_t s = 0; s < layer.src().size(); ++s)
+            {
+                LayoutTensors::const_iterator it = tensors.find(layer.src()[s]);
+                LayoutTensor src = it != tensors.end() ? it->second : LayoutTensor();
+                if (s == 0)
+                    info = src;
+                else
+                {
+                    uniform = uniform && src.format == info.format && src.shaped;
+                    if (layer.type() == LayerTypeConcat)
+                        info.channels += src.channels;
+                }
+            }
+            uniform = uniform && info.shaped && layer.src().size() && layer.dst().size() == 1 &&
+                (info.format == TensorFormatNchw || info.format == TensorFormatNhwc);
+            bool flexible = false;
+            switch (layer.type())
+            {
+            case LayerTypeInput:
+            {
+                const InputParam& input = layer.input();
+                for (size_t d = 0; d < layer.dst().size() && d < input.shape().size(); ++d)
+                {
+                    const ShapeParam& shape = input.shape()[d];
+                    LayoutTensor& dst = tensors[layer.dst()[d]];
+                    dst.format = shape.format();
+                    dst.shaped = shape.dim().size() == 4;
+                    if (dst.shaped)
+                    {
+                        bool trans = shape.format() == TensorFormatNhwc;
+                        dst.channels = Max<double>(1.0, double(shape.dim()[trans ? 3 : 1]));
+                        dst.spatial = Max<double>(1.0, double(shape.dim()[trans ? 1 : 2] * shape.dim()[trans ? 2 : 3]));
+                    }
+                }
+                return false;
+            }
+            case LayerTypePermute:
+            {
+                info.shaped = info.shaped && IsLayoutPermute(layer);
+                if (layer.permute().format() != TensorFormatUnknown)
+                    info.format = layer.permute().format();
+                break;
+            }
+            case LayerTypeConvolution:
+            {
+                const ConvolutionParam& conv = layer.convolution();
+                const WeightParam& weight = layer.weight()[0];
+                TensorFormat format = weight.format() == TensorFormatNhwc ? TensorFormatNhwc : TensorFormatNchw;
+                flexible = uniform && info.format == format && conv.kernel().size() == 2 && weight.dim().size() == 4 &&
+                    weight.offset() != size_t(-1) && offsets.at(weight.offset()) == 1 && 
+                    weight.offset() + weight.size() <= bin.size() * sizeof(float);
+                info.format = format;
+                info.shaped = conv.kernel().size() == 2;
+                info.channels = conv.outputNum();
+                info.spatial /= Stride(conv.stride());
+                break;
+            }
+            case LayerTypePooling:
+            {
+                flexible = uniform;
+                info.shaped = true;
+                info.spatial = layer.pooling().globalPooling() ? 1.0 : info.spatial / Stride(layer.pooling().stride());
+                break;
+            }
+            case LayerTypeConcat:
+            {
+                uint32_t axis = layer.concat().axis();
+                flexible = uniform && ((info.format == TensorFormatNchw && axis == 1) || (info.format == TensorFormatNhwc && axis == 3));
+                break;
+            }
+            case LayerTypeInterp:
+            case LayerTypeInterp2:
+            {
+                flexible = uniform && layer.src().size() == 1;
+                double zoom = layer.type() == LayerTypeInterp ? double(layer.interp().zoomFactor()) / layer.interp().shrinkFactor() : layer.interp2().factor();
+                info.spatial *= zoom * zoom;
+                break;
+            }
+            case LayerTypeBatchNorm:
+            case LayerTypeBias:
+            case LayerTypePrelu:
+            case LayerTypeScale:
+                flexible = uniform && layer.src().size() == 1;
+                break;
+            case LayerTypeAdd:
+            case LayerTypeEltwise:
+            case LayerTypeElu:
+            case LayerTypeHswish:
+            case LayerTypeLrn:
+            case LayerTypeMish:
+            case LayerTypePower:
+            case LayerTypeRelu:
+            case LayerTypeRestrictRange:
+            case LayerTypeSigmoid:
+            case LayerTypeSoftplus:
+                flexible = uniform;
+                break;
+            default:
+                info.shaped = false;
+            }
+            for (size_t d = 0; d < layer.dst().size(); ++d)
+                tensors[layer.dst()[d]] = info;
+            return flexible;
+        }
+
+        double LayoutCost(const LayerParam& layer, const LayoutTensors& tensors, TensorFormat format) const
+        {
+            const LayoutTensor& dst = tensors.at(layer.dst()[0]);
+            bool trans = format == TensorFormatNhwc;
+            if (layer.type() == LayerTypeConvolution)
+            {
+                const ConvolutionParam& conv = layer.convolution();
+                double macs = dst.Size() * conv.kernel()[0] * conv.kernel()[1] * tensors.at(layer.src()[0]).channels / conv.group();
+                if (conv.group() > 1 && conv.group() == conv.outputNum())
+                    return macs / 8.0 * (trans ? 1.0 : 3.0);
+                return macs / 16.0 * (trans ? 1.0 : (conv.group() > 1 ? 1.5 : 1.125));
+            }
+            if (layer.type() == LayerTypeConcat)
+                return dst.Size() * (trans ? 1.5 : 1.0);
+            return dst.Size();
+        }
+
+        static bool IsLayoutPermute(const LayerParam& layer)
+        {
+            if (layer.type() != LayerTypePermute)
+                return false;
+            const PermuteParam& permute = layer.permute();
+            return (permute.format() == TensorFormatNhwc && permute.order() == Shp(0, 2, 3, 1)) ||
+                (permute.format() == TensorFormatNchw && permute.order() == Shp(0, 3, 1, 2));
+        }
+
+        static int LayoutRegion(Ints& region, int index)
+        {
+            while (region[index] != index)
+                index = region[index] = region[region[index]];
+            return index;
+        }
+
+        static double Stride(const Shape& stride)
+        {
+            return stride.empty() ? 1.0 : double(stride[0] * stride.back());
+        }
+
+        static LayerParam LayoutPermute(const String& name, const String& src, const String& dst, TensorFormat format)
+        {
+            LayerParam permute;
+            permute.type() = LayerTypePermute;
+            permute.name() = name;
+            permute.src().push_back(src);
+            permute.dst().push_back(dst);
+            permute.permute().order() = format == TensorFormatNhwc ? Shp(0, 2, 3, 1) : Shp(0, 3, 1, 2);
+            permute.permute().format() = format;
+            return permute;
+        }
+
+        static bool ReorderWeight(WeightParam& weight, TensorFormat format, Floats& bin)
+        {
+            Shape& dim = weight.dim();
+            float* data = bin.data() + weight.offset() / sizeof(float);
+            Floats src(data, data + dim[0] * dim[1] * dim[2] * dim[3]);
+            if (format == TensorFormatNhwc)
+            {
+                size_t O = dim[0], I = dim[1], Y = dim[2], X = dim[3];
+                for (size_t o = 0, n = 0; o < O; ++o)
+                    for (size_t i = 0; i < I; ++i)
+                        for (size_t y = 0; y < Y; ++y)
+                            for (size_t x = 0; x < X; ++x, ++n)
+                                data[((y * X + x) * I + i) * O + o] = src[n];
+                dim = Shp(Y, X, I, O);
+            }
+            else
+            {
+                size_t Y = dim[0], X = dim[1], I = dim[2], O = dim[3];
+                for (size_t y = 0, n = 0; y < Y; ++y)
+                    for (size_t x = 0; x < X; ++x)
+                        for (size_t i = 0; i < I; ++i)
+                            for (size_t o = 0; o < O; ++o, ++n)
+                                data[((o * I + i) * Y + y) * X + x] = src[n];
+                dim = Shp(O, I, Y, X);
+            }
+            weight.format() = format;
+            return true;
+        }
+
         bool IsSub(const LayerParam & layer) const
         {
             if (layer.type() == LayerTypeEltwise && layer.eltwise().operation() == EltwiseOperationTypeSum && layer.eltwise().coefficients() == Floats({ 1.0f, -1.0f }))
@@ -1624,9 +2205,78 @@ namespace Synet
             }
             return true;
         }
+
+        bool AlignWeight(Synet::NetworkParam& network, Floats& bin)
+        {
+            const size_t align = _param.weightAlignment();
+            if (align <= sizeof(float) || align % sizeof(float) || bin.empty())
+                return true;
+            LayerParams& layers = network.layers();
+            std::map<size_t, size_t> sizes;
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                for (size_t j = 0; j < layers[i].weight().size(); ++j)
+                {
+                    const WeightParam & weight = layers[i].weight()[j];
+                    if (weight.offset() == size_t(-1) || weight.size() == size_t(-1) || weight.offset() % sizeof(float))
+                        return true;
+                    if (weight.offset() + weight.size() > bin.size() * sizeof(float))
+                    {
+                        std::cout << "Weight " << j << " of layer " << layers[i].name() << " is out of weight file!" << std::endl;
+                        return false;
+                    }
+                    size_t & size = sizes[weight.offset()];
+                    size = std::max(size, weight.size());
+                }
+            }
+            std::map<size_t, size_t> offsets;
+            Floats aligned;
+            aligned.reserve(bin.size());
+            for (std::map<size_t, size_t>::iterator it = sizes.begin(); it != sizes.end(); ++it)
+            {
+                aligned.resize(DivHi(aligned.size() * sizeof(float), align) * align / sizeof(float), 0.0f);
+                offsets[it->first] = aligned.size() * sizeof(float);
+                const float* src = bin.data() + it->first / sizeof(float);
+                aligned.insert(aligned.end(), src, src + DivHi(it->second, sizeof(float)));
+            }
+            for (size_t i = 0; i < layers.size(); ++i)
+                for (size_t j = 0; j < layers[i].weight().size(); ++j)
+                    layers[i].weight()[j].offset() = offsets[layers[i].weight()[j].offset()];
+            bin.swap(aligned);
+            return true;
+        }
     };
 
-    inline bool OptimizeSynetModel(const String& srcXml, const String& srcBin, const String& dstXml, const String & dstBin)
+    inline bool IsBinaryModelPath(const String& path)
+    {
+        return path.size() > 5 && ToLowerCase(path.substr(path.size() - 5)) == ".synb";
+    }
+
+    inline bool SaveSynetModel(const NetworkParamHolder& network, const Floats& bin, const String& dstModel, const String& dstWeight)
+    {
+        if (IsBinaryModelPath(dstModel))
+        {
+            if (!network.SaveBinary(dstModel, (const char*)bin.data(), bin.size() * sizeof(float)))
+            {
+                std::cout << "Can't save Synet binary model '" << dstModel << "' !" << std::endl;
+                return false;
+            }
+            return true;
+        }
+        if (!network.Save(dstModel, false))
+        {
+            std::cout << "Can't save Synet model '" << dstModel << "' !" << std::endl;
+            return false;
+        }
+        if (!dstWeight.empty() && !SaveBinaryData(bin, dstWeight))
+        {
+            std::cout << "Can't save Synet weight '" << dstWeight << "' !" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    inline bool OptimizeSynetModel(const String& srcXml, const String& srcBin, const String& dstXml, const String & dstBin, const OptimizerParam& optParam = OptimizerParam())
     {
         NetworkParamHolder network;
         if (!network.Load(srcXml))
@@ -1640,23 +2290,12 @@ namespace Synet
             std::cout << "Can't load Synet weight '" << srcBin << "' !" << std::endl;
             return false;
         }
-        OptimizerParamHolder param;
-        Optimizer optimizer(param());
+        Optimizer optimizer(optParam);
         if (!optimizer.Run(network(), bin))
         {
             std::cout << "Can't optimize Synet model!" << std::endl;
             return false;
         }
-        if (!network.Save(dstXml, false))
-        {
-            std::cout << "Can't save Synet model '" << dstXml << "' !" << std::endl;
-            return false;
-        }
-        if (!dstBin.empty() && !SaveBinaryData(bin, dstBin))
-        {
-            std::cout << "Can't save Synet weight '" << dstBin << "' !" << std::endl;
-            return false;
-        }
-        return true;
+        return SaveSynetModel(network, bin, dstXml, dstBin);
     }
 }
\ No newline at end of file
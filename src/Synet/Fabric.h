@@ -36,7 +36,9 @@
 #include "Synet/Layers/Convolution8iLayer.h"
 #include "Synet/Layers/CtcGreedyDecoderLayer.h"
 #include "Synet/Layers/DeconvolutionLayer.h"
+#include "Synet/Layers/Deconvolution8iLayer.h"
 #include "Synet/Layers/DetectionOutputLayer.h"
+#include "Synet/Layers/ElementwiseLayer.h"
 #include "Synet/Layers/EltwiseLayer.h"
 #include "Synet/Layers/EluLayer.h"
 #include "Synet/Layers/ExpandDimsLayer.h"
@@ -117,9 +119,14 @@ namespace Synet
                 else
                     return new Convolution32fLayer<T>(param, context);
             case LayerTypeCtcGreedyDecoder: return new CtcGreedyDecoderLayer<T>(param, context);
-            case LayerTypeDeconvolution: return new DeconvolutionLayer<T>(param, context);
+            case LayerTypeDeconvolution:
+                if (param.convolution().quantizationLevel() == TensorType8i)
+                    return new Deconvolution8iLayer<T>(param, context, method);
+                else
+                    return new DeconvolutionLayer<T>(param, context);
             case LayerTypeDetectionOutput: return new DetectionOutputLayer<T>(param, context);
             case LayerTypeDropout: return new StubLayer<T>(param, context);
+            case LayerTypeElementwise: return new ElementwiseLayer<T>(param, context);
             case LayerTypeEltwise: return new EltwiseLayer<T>(param, context);
             case LayerTypeElu: return new EluLayer<T>(param, context);
             case LayerTypeExpandDims: return new ExpandDimsLayer<T>(param, context);
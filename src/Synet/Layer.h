@@ -176,7 +176,7 @@ namespace Synet
             return true;
         }
 
-        bool Load(const char * & data, size_t & size, const LayerSharedPtrs & layers)
+        bool Load(const char * & data, size_t & size, const LayerSharedPtrs & layers, bool share = false)
         {
             _weight.resize(_param.weight().size());
             for (size_t i = 0; i < _weight.size(); ++i)
@@ -201,14 +201,26 @@ namespace Synet
                     {
                         if (offset + length > size)
                             return false;
-                        tensor.Reshape(param.dim(), Type(), param.format());
-                        memcpy((char*)tensor.CpuData(), data + offset, length);
+                        if (share && size_t(data + offset) % sizeof(T) == 0)
+                            tensor.ShareAs((const Type*)(data + offset), length / sizeof(T), param.dim(), param.format());
+                        else
+                        {
+                            tensor.Reshape(param.dim(), Type(), param.format());
+                            memcpy((char*)tensor.CpuData(), data + offset, length);
+                        }
                     }
                 }
             }
             return true;
         }
 
+        virtual void Share(const Layer & layer)
+        {
+            _weight.resize(layer._weight.size());
+            for (size_t i = 0; i < _weight.size(); ++i)
+                _weight[i].Share(layer._weight[i]);
+        }
+
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst) = 0;
 
@@ -221,6 +233,11 @@ namespace Synet
             _perfFlop = flop;
         }
 
+        Context * GetContext() const
+        {
+            return _context;
+        }
+
         static float * Buf32f(const TensorPtrs& buf, size_t idx)
         {
             return buf[TensorType32f * BUFFER_COUNT + idx]->As32f().CpuData();
@@ -47,10 +47,21 @@ namespace Synet
             return this->Param().concat().can8i();
         }
 
+        bool CanInPlace() const
+        {
+            return _concatNum == 1 && _srcConcatAxis.size() > 1 && !_fixed;
+        }
+
+        void SetInPlace(bool inPlace)
+        {
+            _inPlace = inPlace;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             _concatAxis = this->Param().concat().axis();
             _fixed = this->Param().concat().fixed();
+            _inPlace = false;
             _concatNum = src[0]->Size(0, _concatAxis);
             _concatInputSize = src[0]->Size(_concatAxis + 1);
             size_t srcSizeSum = src[0]->Size();
@@ -94,7 +105,7 @@ namespace Synet
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            if (src.size() == 1 || _fixed)
+            if (src.size() == 1 || _fixed || _inPlace)
                 return;
             ForwardCpu(src, dst);
         }
@@ -165,6 +176,6 @@ namespace Synet
         size_t _concatNum, _concatInputSize, _concatAxis, _dstConcatAxis;
         Index _srcConcatAxis;
         TensorType _type;
-        bool _fixed;
+        bool _fixed, _inPlace;
     };
 }
@@ -40,119 +40,348 @@ namespace Synet
 
         Convolution32fLayer(const LayerParam & param, Context* context)
             : ConvolutionLayer<T>(param, context)
+            , _method(MethodGemm)
         {
         }
 
         virtual size_t MemoryUsage() const
         {
-            return Base::MemoryUsage() + _convolution32f.InternalBufferSize() * sizeof(Type);
+            return Base::MemoryUsage() + _convolution32f.InternalBufferSize() * sizeof(Type) + _winograd.MemoryUsage();
+        }
+
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _method = ((const Convolution32fLayer&)layer)._method;
+            _convolution32f.Share(((const Convolution32fLayer&)layer)._convolution32f);
+            _winograd.Share(((const Convolution32fLayer&)layer)._winograd);
         }
 
     protected:
         typedef typename ConvolutionLayer<T>::AlgParam AlgParam;
 
+        enum Method
+        {
+            MethodSimd = 0,
+            MethodSimdExternal,
+            MethodGemm,
+            MethodWinograd2x3,
+            MethodWinograd4x3,
+            MethodSize
+        };
+
         virtual String InternalInfo() const
         {
-            return  String(" fp32") + (_convolution32f.Enable() ? String(" ") + _convolution32f.Info() : String());
+            switch (_method)
+            {
+            case MethodSimd: 
+            case MethodSimdExternal: 
+                return String(" fp32 ") + _convolution32f.Info();
+            case MethodWinograd2x3: 
+                return String(" fp32 winograd-2x3");
+            case MethodWinograd4x3: 
+                return String(" fp32 winograd-4x3");
+            default: 
+                return String(" fp32");
+            }
         }
 
         virtual void Reshape(const TensorPtr& src, const TensorPtrs& buf, const TensorPtr& dst)
         {
-            const Tensors& weight = this->Weight();
             const ConvParam& conv = this->_conv;
             AlgParam & alg = this->_alg;
 
             dst->Reshape(conv.DstShape(alg.batch), src->Format());
-            _convolution32f.Init(alg.batch, &conv, SYNET_EXTERNAL_GEMM);
-            if (_convolution32f.Enable())
+            alg.sSize = src->Size(1);
+            alg.dSize = dst->Size(1);
+            _method = SelectMethod();
+            switch (_method)
             {
+            case MethodSimd:
+            case MethodSimdExternal:
                 Base::Extend32f(buf, 0, Shp(_convolution32f.ExternalBufferSize()), src->Format());
-                _convolution32f.SetParams(weight[0].CpuData(), &alg.internal, alg.bias ? weight[1].CpuData() : NULL,
-                    conv.activation == ActivationFunctionTypePrelu ? weight.back().CpuData() : alg.params);
-            }
-            else
+                break;
+            case MethodWinograd2x3:
+            case MethodWinograd4x3:
+                Base::Extend32f(buf, 0, Shp(_winograd.SrcBufSize()), src->Format());
+                Base::Extend32f(buf, 1, Shp(_winograd.DstBufSize()), src->Format());
+                break;
+            default:
                 Base::Extend32f(buf, 0, Shp(conv.ImgSize()), src->Format());
+            }
         }
 
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-             ForwardCpu(src[0]->CpuData(), Base::Buf32f(buf, 0), dst[0]->CpuData());
+             ForwardCpu(src[0]->CpuData(), Base::Buf32f(buf, 0), Base::Buf32f(buf, 1), dst[0]->CpuData());
         }
 
-        void ForwardCpu(const T * src, T * buf, T * dst)
+        void ForwardCpu(const T * src, T * buf0, T * buf1, T * dst)
         {
-            if (_convolution32f.Enable())
-                _convolution32f.Forward(src, buf, dst);
-            else
+            const AlgParam& alg = this->_alg;
+            switch (_method)
             {
-                const Type * weight = this->Weight()[0].CpuData();
-                const ConvParam& conv = this->_conv;
-                const AlgParam& alg = this->_alg;
+            case MethodSimd:
+            case MethodSimdExternal:
+                _convolution32f.Forward(src, buf0, dst);
+                break;
+            case MethodWinograd2x3:
+            case MethodWinograd4x3:
                 for (size_t b = 0; b < alg.batch; ++b)
                 {
-                    const Type * tmp = src;
-                    if (!alg.is1x1)
-                    {
-                        if (alg.trans)
-                            Synet::ImgToRow(tmp, conv.srcH, conv.srcW, conv.srcC, conv.kernelY, conv.kernelX, 
-                                conv.padY, conv.padX, conv.padH, conv.padW, conv.strideY, conv.strideX, 
-                                conv.dilationY, conv.dilationX, conv.group, (const Type*)NULL, buf);
-                        else
-                            Synet::ImgToCol(tmp, conv.srcC, conv.srcH, conv.srcW, conv.kernelY, conv.kernelX, 
-                                conv.padY, conv.padX, conv.padH, conv.padW, conv.strideY, conv.strideX, 
-                                conv.dilationY, conv.dilationX, (const Type*)NULL, buf);
-                        tmp = buf;
-                    }
-                    if (alg.trans)
-                    {
-                        assert(conv.group == 1 || conv.group == conv.srcC);
-                        for (size_t g = 0; g < conv.group; ++g)
-                            CpuGemm(CblasNoTrans, CblasNoTrans, alg.siS, alg.siD, alg.siW, Type(1), tmp + alg.grS * g, alg.ldS,
-                                weight + alg.grW * g, alg.ldW, Type(0), dst + alg.grD * g, alg.ldD);
-                    }
-                    else
-                    {
-                        for (size_t g = 0; g < conv.group; ++g)
-                            CpuGemm(CblasNoTrans, CblasNoTrans, alg.siD, alg.siS, alg.siW, Type(1), weight + alg.grW * g, alg.ldW,
-                                tmp + alg.grS * g, alg.ldS, Type(0), dst + alg.grD * g, alg.ldD);
-                    }
-                    if (alg.bias)
-                        CpuAddBias(this->Weight()[1].CpuData(), conv.dstC, conv.dstH*conv.dstW, dst, alg.trans);
-                    switch (conv.activation)
-                    {
-                    case ActivationFunctionTypeIdentity:
-                        break;
-                    case ActivationFunctionTypeRelu:
-                        CpuRelu(dst, alg.dSize, 0.0f, dst);
-                        break;
-                    case ActivationFunctionTypeLeakyRelu:
-                        CpuRelu(dst, alg.dSize, alg.params[0], dst);
-                        break;
-                    case ActivationFunctionTypeRestrictRange:
-                        CpuRestrictRange(dst, alg.dSize, alg.params[0], alg.params[1], dst);
-                        break;
-                    case ActivationFunctionTypePrelu:
-                        Detail::PreluLayerForwardCpu(dst, this->Weight().back().CpuData(), conv.dstC, conv.dstH * conv.dstW, dst, alg.trans);
-                        break;
-                    case ActivationFunctionTypeElu:
-                        CpuElu(dst, alg.dSize, alg.params[0], dst);
-                        break;
-                    case ActivationFunctionTypeHswish:
-                        Detail::HswishLayerForwardCpu(dst, alg.dSize, alg.params[0], alg.params[1], dst);
-                        break;
-                    case ActivationFunctionTypeMish:
-                        CpuMish(dst, alg.dSize, alg.params[0], dst);
-                        break;
-                    default:
-                        assert(0);
-                    }
+                    _winograd.Convolution(src, buf0, buf1, dst);
+                    PostProcess(dst);
                     src += alg.sSize;
                     dst += alg.dSize;
                 }
+                break;
+            default:
+                ForwardGemm(src, buf0, dst);
+            }
+        }
+
+        void ForwardGemm(const T * src, T * buf, T * dst)
+        {
+            const Type * weight = this->Weight()[0].CpuData();
+            const ConvParam& conv = this->_conv;
+            const AlgParam& alg = this->_alg;
+            for (size_t b = 0; b < alg.batch; ++b)
+            {
+                const Type * tmp = src;
+                if (!alg.is1x1)
+                {
+                    if (alg.trans)
+                        Synet::ImgToRow(tmp, conv.srcH, conv.srcW, conv.srcC, conv.kernelY, conv.kernelX, 
+                            conv.padY, conv.padX, conv.padH, conv.padW, conv.strideY, conv.strideX, 
+                            conv.dilationY, conv.dilationX, conv.group, (const Type*)NULL, buf);
+                    else
+                        Synet::ImgToCol(tmp, conv.srcC, conv.srcH, conv.srcW, conv.kernelY, conv.kernelX, 
+                            conv.padY, conv.padX, conv.padH, conv.padW, conv.strideY, conv.strideX, 
+                            conv.dilationY, conv.dilationX, (const Type*)NULL, buf);
+                    tmp = buf;
+                }
+                if (alg.trans)
+                {
+                    assert(conv.group == 1 || conv.group == conv.srcC);
+                    for (size_t g = 0; g < conv.group; ++g)
+                        CpuGemm(CblasNoTrans, CblasNoTrans, alg.siS, alg.siD, alg.siW, Type(1), tmp + alg.grS * g, alg.ldS,
+                            weight + alg.grW * g, alg.ldW, Type(0), dst + alg.grD * g, alg.ldD);
+                }
+                else
+                {
+                    for (size_t g = 0; g < conv.group; ++g)
+                        CpuGemm(CblasNoTrans, CblasNoTrans, alg.siD, alg.siS, alg.siW, Type(1), weight + alg.grW * g, alg.ldW,
+                            tmp + alg.grS * g, alg.ldS, Type(0), dst + alg.grD * g, alg.ldD);
+                }
+                PostProcess(dst);
+                src += alg.sSize;
+                dst += alg.dSize;
+            }
+        }
+
+        void PostProcess(T * dst)
+        {
+            const ConvParam& conv = this->_conv;
+            const AlgParam& alg = this->_alg;
+            if (alg.bias)
+                CpuAddBias(this->Weight()[1].CpuData(), conv.dstC, conv.dstH*conv.dstW, dst, alg.trans);
+            switch (conv.activation)
+            {
+            case ActivationFunctionTypeIdentity:
+                break;
+            case ActivationFunctionTypeRelu:
+                CpuRelu(dst, alg.dSize, 0.0f, dst);
+                break;
+            case ActivationFunctionTypeLeakyRelu:
+                CpuRelu(dst, alg.dSize, alg.params[0], dst);
+                break;
+            case ActivationFunctionTypeRestrictRange:
+                CpuRestrictRange(dst, alg.dSize, alg.params[0], alg.params[1], dst);
+                break;
+            case ActivationFunctionTypePrelu:
+                Detail::PreluLayerForwardCpu(dst, this->Weight().back().CpuData(), conv.dstC, conv.dstH * conv.dstW, dst, alg.trans);
+                break;
+            case ActivationFunctionTypeElu:
+                CpuElu(dst, alg.dSize, alg.params[0], dst);
+                break;
+            case ActivationFunctionTypeHswish:
+                Detail::HswishLayerForwardCpu(dst, alg.dSize, alg.params[0], alg.params[1], dst);
+                break;
+            case ActivationFunctionTypeMish:
+                CpuMish(dst, alg.dSize, alg.params[0], dst);
+                break;
+            default:
+                assert(0);
+            }
+        }
+
+        bool Init(Method method)
+        {
+            const Tensors& weight = this->Weight();
+            const ConvParam& conv = this->_conv;
+            AlgParam& alg = this->_alg;
+            switch (method)
+            {
+            case MethodSimd:
+            case MethodSimdExternal:
+#ifndef SYNET_BLIS_ENABLE
+                if (method == MethodSimdExternal)
+                    return false;
+#endif
+                _convolution32f.Init(alg.batch, &conv, method == MethodSimdExternal ? SYNET_EXTERNAL_GEMM : (Convolution32f::Gemm32fNNPtr)NULL);
+                if (!_convolution32f.Enable())
+                    return false;
+                _convolution32f.SetParams(weight[0].CpuData(), &alg.internal, alg.bias ? weight[1].CpuData() : NULL,
+                    conv.activation == ActivationFunctionTypePrelu ? weight.back().CpuData() : alg.params);
+                return true;
+            case MethodGemm:
+                _convolution32f.Release();
+                alg.internal = 0;
+                return true;
+            case MethodWinograd2x3:
+            case MethodWinograd4x3:
+                if (alg.trans)
+                    return false;
+                _winograd.Init(Shp(conv.srcC, conv.srcH, conv.srcW), conv.dstC, Shp(conv.kernelY, conv.kernelX), Shp(conv.strideY, conv.strideX),
+                    Shp(conv.dilationY, conv.dilationX), Shp(conv.padY, conv.padX, conv.padH, conv.padW), conv.group, method == MethodWinograd2x3 ? 2 : 4);
+                if (!_winograd.Enable())
+                    return false;
+                _winograd.SetFilter(weight[0].CpuData());
+                _convolution32f.Release();
+                alg.internal = 0;
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        Method SelectMethod()
+        {
+            if (this->_alg.internal && Init(_method))
+                return _method;
+            String key = TuningKey();
+            int method;
+            TuningCache & tuning = this->GetContext()->tuning;
+            if (tuning.Get(key, method) && method >= 0 && method < MethodSize && Init((Method)method))
+            {
+                if (tuning.Checked(key) || Check((Method)method))
+                {
+                    tuning.SetChecked(key);
+                    return (Method)method;
+                }
+                std::cout << "Tuned method " << method << " of " << this->Param().name() << " gives wrong output and is ignored!" << std::endl;
+            }
+            if (this->GetContext()->options.autoTuning)
+            {
+                method = Tune();
+                this->GetContext()->tuning.Set(key, method);
+                return (Method)method;
+            }
+            if (Init(MethodSimdExternal))
+                return MethodSimdExternal;
+            if (Init(MethodSimd))
+                return MethodSimd;
+            Init(MethodGemm);
+            return MethodGemm;
+        }
+
+        String TuningKey() const
+        {
+            const ConvParam& conv = this->_conv;
+            std::stringstream key;
+            key << "conv32f-" << this->_alg.batch << "x" << conv.srcC << "x" << conv.srcH << "x" << conv.srcW;
+            key << "-" << conv.dstC << "x" << conv.kernelY << "x" << conv.kernelX;
+            key << "-" << conv.strideY << "x" << conv.strideX << "-" << conv.dilationY << "x" << conv.dilationX;
+            key << "-" << conv.padY << "x" << conv.padX << "x" << conv.padH << "x" << conv.padW;
+            key << "-" << conv.group << "-" << (this->_alg.trans ? "nhwc" : "nchw") << "-" << conv.activation;
+            key << "-t" << GetThreadNumber();
+            return key.str();
+        }
+
+        void TuningSrc(std::vector<Type> & src) const
+        {
+            const AlgParam& alg = this->_alg;
+            src.resize(alg.batch * alg.sSize);
+            for (size_t i = 0; i < src.size(); ++i)
+                src[i] = Type(int(i * 7 % 31) - 15) / Type(16);
+        }
+
+        void TuningBuf(std::vector<Type> & buf0, std::vector<Type> & buf1)
+        {
+            switch (_method)
+            {
+            case MethodSimd:
+            case MethodSimdExternal:
+                buf0.resize(_convolution32f.ExternalBufferSize() + 1);
+                break;
+            case MethodWinograd2x3:
+            case MethodWinograd4x3:
+                buf0.resize(_winograd.SrcBufSize());
+                buf1.resize(_winograd.DstBufSize());
+                break;
+            default:
+                buf0.resize(this->_conv.ImgSize());
+            }
+        }
+
+        bool Check(Method method)
+        {
+            if (method == MethodGemm)
+                return true;
+            const AlgParam& alg = this->_alg;
+            std::vector<Type> src, dst(alg.batch * alg.dSize), ref(dst.size()), buf0, buf1;
+            TuningSrc(src);
+            buf0.resize(this->_conv.ImgSize());
+            ForwardGemm(src.data(), buf0.data(), ref.data());
+            _method = method;
+            TuningBuf(buf0, buf1);
+            ForwardCpu(src.data(), buf0.data(), buf1.data(), dst.data());
+            return Similar(ref, dst);
+        }
+
+        int Tune()
+        {
+            const AlgParam& alg = this->_alg;
+            std::vector<Type> src, dst(alg.batch * alg.dSize), ref, buf0, buf1;
+            TuningSrc(src);
+            int best = MethodGemm;
+            double bestTime = DBL_MAX;
+            for (int m = 0; m < MethodSize; ++m)
+            {
+                _method = (Method)m;
+                if (!Init(_method))
+                    continue;
+                TuningBuf(buf0, buf1);
+                double time = TuningTime([&]() { ForwardCpu(src.data(), buf0.data(), buf1.data(), dst.data()); });
+                if (ref.empty())
+                    ref = dst;
+                else if (!Similar(ref, dst))
+                    continue;
+                if (time < bestTime)
+                {
+                    bestTime = time;
+                    best = m;
+                }
+            }
+            _method = (Method)best;
+            Init(_method);
+            return best;
+        }
+
+        static bool Similar(const std::vector<Type> & a, const std::vector<Type> & b)
+        {
+            Type diff = 0, norm = 0;
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                diff = Max(diff, (Type)::fabs(a[i] - b[i]));
+                norm = Max(norm, (Type)::fabs(a[i]));
             }
+            return diff <= Type(0.001) * Max(norm, Type(1));
         }
 
     private:
+        Method _method;
         Convolution32f _convolution32f;
+        Winograd<Type> _winograd;
     };
 }
\ No newline at end of file
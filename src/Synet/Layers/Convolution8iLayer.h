@@ -57,6 +57,12 @@ namespace Synet
                 + _weight8i.MemoryUsage() + _norm32f.MemoryUsage() + _bias32f.MemoryUsage();
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _convolution8i.Share(((const Convolution8iLayer&)layer)._convolution8i);
+        }
+
         virtual bool Can8i() const
         {
             return true;
@@ -0,0 +1,196 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Layers/DeconvolutionLayer.h"
+#include "Synet/Quantization/Const.h"
+#include "Synet/Quantization/Convert.h"
+
+namespace Synet
+{
+    template <class T> class Deconvolution8iLayer : public Synet::DeconvolutionLayer<T>
+    {
+    public:
+        typedef T Type;
+        typedef Layer<T> Base;
+        typedef typename Base::Tensor Tensor;
+        typedef std::vector<Tensor> Tensors;
+        typedef typename Base::TensorPtrs TensorPtrs;
+
+        Deconvolution8iLayer(const LayerParam& param, Context* context, QuantizationMethod method)
+            : DeconvolutionLayer<T>(param, context)
+            , _method(method)
+        {
+            assert(param.convolution().quantizationLevel() == TensorType8i);
+            _src8u = false;
+            _dst8u = false;
+        }
+
+        virtual size_t MemoryUsage() const
+        {
+            return Base::MemoryUsage() + _weight8i.MemoryUsage() + _norm32f.MemoryUsage() + _bias32f.MemoryUsage();
+        }
+
+        virtual void CompactWeight()
+        {
+            ((Tensor&)this->Weight()[0]).Clear();
+        }
+
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
+        virtual bool Is8i() const
+        {
+            return true;
+        }
+
+        virtual void DebugPrint(std::ostream& os, int flag, int first, int last, int precision)
+        {
+            Synet::DebugPrint(os, _srcCvt.scale, _srcCvt.channels, "_srcCvt.scale", first, last, precision);
+            Synet::DebugPrint(os, _srcCvt.shift, _srcCvt.channels, "_srcCvt.shift", first, last, precision);
+            _weight8i.DebugPrint(os, "_weight8i", true, first, last, precision);
+            _norm32f.DebugPrint(os, "_norm32f", false, first, last, precision);
+            _bias32f.DebugPrint(os, "_bias32f", false, first, last, precision);
+            Synet::DebugPrint(os, _dstCvt.scale, _dstCvt.channels, "_dstCvt.scale", first, last, precision);
+            Synet::DebugPrint(os, _dstCvt.shift, _dstCvt.channels, "_dstCvt.shift", first, last, precision);
+        }
+
+        virtual void Reshape(const TensorPtrs& src, const TensorPtrs& buf, const TensorPtrs& dst)
+        {
+            const ConvParam& conv = this->_conv;
+            Shape dstShape = this->InitConv(src, dst);
+            _src8u = src[0]->GetType() == TensorType8u;
+            _dst8u = dst[0]->GetType() == TensorType8u;
+            if (_dst8u)
+                dst[0]->As8u().Reshape(dstShape, src[0]->Format());
+            else
+                dst[0]->As32f().Reshape(dstShape, src[0]->Format());
+            if (!_src8u)
+                Base::Extend8u(buf, 0, Shp(this->_srcSize));
+            Base::Extend32i(buf, 0, Shp(DeconvolutionDirectBufferSize(conv)));
+            if (_dst8u)
+                Base::Extend32f(buf, 0, Shp(this->_dstSize));
+            Quantize();
+            std::stringstream desc;
+            desc << this->PerfDesc() << " int8-" << (_src8u ? "u" : "f") << (_dst8u ? "u" : "f");
+            this->UsePerfStat(desc.str(), this->Flop());
+        }
+
+    protected:
+        virtual void ForwardCpu(const TensorPtrs& src, const TensorPtrs& buf, const TensorPtrs& dst)
+        {
+            const ConvParam& conv = this->_conv;
+            const float* src32f = _src8u ? NULL : src[0]->As32f().CpuData();
+            uint8_t* src8u = _src8u ? src[0]->As8u().CpuData() : Base::Buf8u(buf, 0);
+            int32_t* sum32i = Base::Buf32i(buf, 0);
+            float* dst32f = _dst8u ? Base::Buf32f(buf, 0) : dst[0]->As32f().CpuData();
+            uint8_t* dst8u = _dst8u ? dst[0]->As8u().CpuData() : NULL;
+            const uint8_t* zero = this->Stats(0)[0]->zero8u.data();
+            typename DeconvolutionLayer<T>::Epilogue epilogue = this->GetEpilogue(_norm32f.CpuData(), _bias32f.CpuData());
+            for (size_t n = 0; n < this->_num; ++n)
+            {
+                if (!_src8u)
+                {
+                    _srcCvt.Convert(src32f, src8u);
+                    src32f += this->_srcSize;
+                }
+                epilogue.dst = dst32f;
+                if (this->_trans)
+                    DeconvolutionDirectNhwc(src8u, conv, _weight8i.CpuData(), zero, sum32i, epilogue);
+                else
+                    DeconvolutionDirectNchw(src8u, conv, _weight8i.CpuData(), zero, sum32i, epilogue);
+                if (_src8u)
+                    src8u += this->_srcSize;
+                if (_dst8u)
+                {
+                    _dstCvt.Convert(dst32f, dst8u);
+                    dst8u += this->_dstSize;
+                }
+                else
+                    dst32f += this->_dstSize;
+            }
+        }
+
+        void Quantize()
+        {
+            const ConvParam& conv = this->_conv;
+            Stat& statS = *this->Stats(0)[0];
+            Stat& statD = *this->Stats(2)[0];
+            statS.Init8u(_method);
+            statD.Init8u(_method);
+            const Tensor& weight = this->Weight()[0];
+            _weight8i.Reshape(weight.Shape(), weight.Format());
+            _norm32f.Reshape(Shp(conv.dstC));
+            _bias32f.Reshape(Shp(conv.dstC));
+            size_t G = conv.group, D = conv.dstC / G, C = conv.srcC / G, K = conv.kernelY * conv.kernelX;
+            const float* pSrcB = this->_biasTerm ? this->Weight()[1].CpuData() : NULL;
+            const float* pScale = statS.scale32fTo8u.data();
+            Floats normW(C * K);
+            for (size_t g = 0; g < G; ++g)
+            {
+                for (size_t d = 0; d < D; ++d)
+                {
+                    float maxW = 0.0f;
+                    for (size_t c = 0, ck = 0; c < C; ++c)
+                    {
+                        for (size_t k = 0; k < K; ++k, ++ck)
+                        {
+                            normW[ck] = weight.CpuData()[WeightIndex(g, c, d, k)] / pScale[g * C + c];
+                            maxW = Max(maxW, Abs(normW[ck]));
+                        }
+                    }
+                    float scale = maxW > 0.0f ? statS.iMax / maxW : 1.0f;
+                    for (size_t c = 0, ck = 0; c < C; ++c)
+                        for (size_t k = 0; k < K; ++k, ++ck)
+                            _weight8i.CpuData()[WeightIndex(g, c, d, k)] = ConvertTo8i(normW[ck], scale, 0, statS.iMin, statS.iMax);
+                    _norm32f.CpuData()[g * D + d] = 1.0f / scale;
+                    _bias32f.CpuData()[g * D + d] = pSrcB ? pSrcB[g * D + d] : 0.0f;
+                }
+            }
+            _srcCvt.Init(1, conv.srcC, conv.srcH, conv.srcW, (TensorFormat)this->_trans, statS.scale32fTo8u.data(), statS.shift32fTo8u.data(), _method);
+            _dstCvt.Init(1, conv.dstC, conv.dstH, conv.dstW, (TensorFormat)this->_trans, statD.scale32fTo8u.data(), statD.shift32fTo8u.data(), _method);
+        }
+
+        SYNET_INLINE size_t WeightIndex(size_t g, size_t c, size_t d, size_t k) const
+        {
+            const ConvParam& conv = this->_conv;
+            size_t D = conv.dstC / conv.group, C = conv.srcC / conv.group, K = conv.kernelY * conv.kernelX;
+            if (this->_trans)
+                return ((g * C + c) * K + k) * D + d;
+            else
+                return ((g * C + c) * D + d) * K + k;
+        }
+
+    private:
+        QuantizationMethod _method;
+        bool _src8u, _dst8u;
+        Converter _srcCvt, _dstCvt;
+        Tensor8i _weight8i;
+        Tensor32f _norm32f, _bias32f;
+    };
+}
\ No newline at end of file
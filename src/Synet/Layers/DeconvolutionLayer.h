@@ -26,10 +26,11 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Utils/Activation.h"
 #include "Synet/Utils/Gemm.h"
-#include "Synet/Utils/ImgToCol.h"
 #include "Synet/Utils/Deconvolution.h"
 #include "Synet/Layers/HswishLayer.h"
+#include "Synet/Layers/PreluLayer.h"
 
 namespace Synet
 {
@@ -46,6 +47,7 @@ namespace Synet
             : Base(param, context)
         {
             _transW = false;
+            _direct = false;
             _internal = 0;
         }
 
@@ -54,6 +56,12 @@ namespace Synet
             return Base::MemoryUsage() + (_deconvolution32f.InternalBufferSize() + _weightT.Size())*sizeof(Type);
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _deconvolution32f.Share(((const DeconvolutionLayer&)layer)._deconvolution32f);
+        }
+
         virtual int64_t Flop() const
         {
             return _num * _conv.kernelY * _conv.kernelX * _conv.srcC * _conv.srcH * _conv.srcW * _conv.dstC / _conv.group * 2;
@@ -66,6 +74,74 @@ namespace Synet
         }
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+            const Tensors & weight = this->Weight();
+            Shape dstShape = InitConv(src, dst);
+            if (_trans)
+            {
+                assert(_conv.group == 1);
+
+                _siW = _conv.srcC / _conv.group;
+                _ldW = _conv.kernelY * _conv.kernelX * _conv.dstC / _conv.group;
+                _grW = 0;// _conv.dstC / _conv.group;
+
+                _siS = _conv.srcH * _conv.srcW;
+                _ldS = _siW;
+                _grS = 0;//_siS * _siW;
+
+                _siD = _conv.kernelY * _conv.kernelX * _conv.dstC / _conv.group;
+                _ldD = _siD;
+                _grD = 0;//_siD;
+            }
+            else
+            {
+                _transW = !_direct;
+
+                _siW = _conv.srcC / _conv.group;
+                _ldW = _transW ? _siW : _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
+                _grW = _siW * _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
+
+                _siS = _conv.srcH * _conv.srcW;
+                _ldS = _siS;
+                _grS = _siS * _siW;
+
+                _siD = _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
+                _ldD = _conv.srcH * _conv.srcW;
+                _grD = _siD * _siS;
+            }
+
+            _deconvolution32f.Init(_num, &_conv, SYNET_EXTERNAL_GEMM);
+            if (_deconvolution32f.Enable())
+            {
+                buf[TensorType32f*BUFFER_COUNT]->Extend({ _deconvolution32f.ExternalBufferSize() });
+                _deconvolution32f.SetParams(weight[0].CpuData(), &_internal, _biasTerm ? weight[1].CpuData() : NULL,
+                    _conv.activation == ActivationFunctionTypePrelu ? weight.back().CpuData() : _params);
+            }
+            else if (_direct)
+                buf[TensorType32f*BUFFER_COUNT]->Extend(Shape({ DeconvolutionDirectBufferSize(_conv) }));
+            else if (_transW)
+            {
+                const Shape & shape = weight[0].Shape();
+                _weightT.Reshape({ shape[1], shape[2], shape[3], shape[0] });
+                size_t m = shape[0], n = shape[1] * shape[2] * shape[3];
+                const T * s = weight[0].CpuData();
+                T * d = _weightT.CpuData();
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                        d[j*m + i] = s[i * n + j];
+            }
+            dst[0]->Reshape(dstShape, src[0]->Format());
+            std::stringstream desc;
+            desc << PerfDesc();
+            if (_deconvolution32f.Enable())
+                desc << " " << _deconvolution32f.Info();
+            else if (_direct)
+                desc << " direct";
+            this->UsePerfStat(desc.str(), Flop());
+        }
+
+    protected:
+        Shape InitConv(const TensorPtrs & src, const TensorPtrs & dst)
         {
             assert(src.size() == 1);
 
@@ -100,85 +176,95 @@ namespace Synet
 
             _num = src[0]->Size(0, _axis);
             _trans = src[0]->Format() == TensorFormatNhwc;
+            _direct = !_is1x1;
             assert(weight[0].Shape() == _conv.WeightShape(_trans != 0, false) && weight[0].Format() == src[0]->Format());
 
             Shape dstShape(src[0]->Shape().begin(), src[0]->Shape().begin() + _axis);
             if (_trans)
             {
-                assert(_conv.group == 1);
-
                 dstShape.push_back(_conv.dstH);
                 dstShape.push_back(_conv.dstW);
                 dstShape.push_back(_conv.dstC);
-
-                _siW = _conv.srcC / _conv.group;
-                _ldW = _conv.kernelY * _conv.kernelX * _conv.dstC / _conv.group;
-                _grW = 0;// _conv.dstC / _conv.group;
-
-                _siS = _conv.srcH * _conv.srcW;
-                _ldS = _siW;
-                _grS = 0;//_siS * _siW;
-
-                _siD = _conv.kernelY * _conv.kernelX * _conv.dstC / _conv.group;
-                _ldD = _siD;
-                _grD = 0;//_siD;
             }
             else
             {
                 dstShape.push_back(_conv.dstC);
                 dstShape.push_back(_conv.dstH);
                 dstShape.push_back(_conv.dstW);
+            }
+            _srcSize = src[0]->Size(_axis);
+            _dstSize = _conv.dstC * _conv.dstH * _conv.dstW;
+            return dstShape;
+        }
 
-                _transW = true;
-
-                _siW = _conv.srcC / _conv.group;
-                _ldW = _transW ? _siW : _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
-                _grW = _siW * _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
-
-                _siS = _conv.srcH * _conv.srcW;
-                _ldS = _siS;
-                _grS = _siS * _siW;
+        String PerfDesc() const
+        {
+            std::stringstream desc;
+            desc << _num << "x" << _conv.srcC << "x" << _conv.srcH << "x" << _conv.srcW;
+            desc << "-" << _conv.dstC << "x" << _conv.kernelY << "x" << _conv.kernelX;
+            desc << "-" << Max(_conv.strideY, _conv.strideX) << "-" << _conv.group;
+            return desc.str();
+        }
 
-                _siD = _conv.dstC * _conv.kernelY * _conv.kernelX / _conv.group;
-                _ldD = _conv.srcH * _conv.srcW;
-                _grD = _siD * _siS;
-            }
+        struct Epilogue
+        {
+            const float * norm, * bias, * slope;
+            const float * params;
+            ActivationFunctionType activation;
+            float * dst;
 
-            _deconvolution32f.Init(_num, &_conv, SYNET_EXTERNAL_GEMM);
-            if (_deconvolution32f.Enable())
+            template<class TD> void operator()(const TD* sum, size_t offset, size_t channel, size_t channels, size_t spatial)
             {
-                buf[TensorType32f*BUFFER_COUNT]->Extend({ _deconvolution32f.ExternalBufferSize() });
-                _deconvolution32f.SetParams(weight[0].CpuData(), &_internal, _biasTerm ? weight[1].CpuData() : NULL,
-                    _conv.activation == ActivationFunctionTypePrelu ? weight.back().CpuData() : _params);
-            }
-            else
-            {
-                buf[TensorType32f*BUFFER_COUNT]->Extend(Shape({ _conv.dstC * _conv.kernelY * _conv.kernelX * _conv.srcH * _conv.srcW }));
-                if (_transW)
+                float * pDst = dst + offset;
+                for (size_t s = 0, i = 0; s < spatial; ++s)
+                {
+                    for (size_t c = 0; c < channels; ++c, ++i)
+                        pDst[i] = float(sum[i]) * (norm ? norm[channel + c] : 1.0f) + (bias ? bias[channel + c] : 0.0f);
+                }
+                size_t size = channels * spatial;
+                switch (activation)
                 {
-                    const Shape & shape = weight[0].Shape();
-                    _weightT.Reshape({ shape[1], shape[2], shape[3], shape[0] });
-                    size_t m = shape[0], n = shape[1] * shape[2] * shape[3];
-                    const T * s = weight[0].CpuData();
-                    T * d = _weightT.CpuData();
-                    for (size_t i = 0; i < m; ++i)
-                        for (size_t j = 0; j < n; ++j)
-                            d[j*m + i] = s[i * n + j];
+                case ActivationFunctionTypeIdentity:
+                    break;
+                case ActivationFunctionTypeRelu:
+                    CpuRelu(pDst, size, 0.0f, pDst);
+                    break;
+                case ActivationFunctionTypeLeakyRelu:
+                    CpuRelu(pDst, size, params[0], pDst);
+                    break;
+                case ActivationFunctionTypeRestrictRange:
+                    CpuRestrictRange(pDst, size, params[0], params[1], pDst);
+                    break;
+                case ActivationFunctionTypePrelu:
+                    Detail::PreluLayerForwardCpu(pDst, slope + channel, channels, spatial, pDst, 1);
+                    break;
+                case ActivationFunctionTypeElu:
+                    CpuElu(pDst, size, params[0], pDst);
+                    break;
+                case ActivationFunctionTypeHswish:
+                    Detail::HswishLayerForwardCpu(pDst, size, params[0], params[1], pDst);
+                    break;
+                case ActivationFunctionTypeMish:
+                    CpuMish(pDst, size, params[0], pDst);
+                    break;
+                default:
+                    assert(0);
                 }
             }
-            dst[0]->Reshape(dstShape, src[0]->Format());
-            _srcSize = src[0]->Size(_axis);
-            _dstSize = dst[0]->Size(_axis);
-            std::stringstream desc;
-            desc << _num << "x" << _conv.srcC << "x" << _conv.srcH << "x" << _conv.srcW;
-            desc << "-" << _conv.dstC << "x" << _conv.kernelY << "x" << _conv.kernelX;
-            desc << "-" << Max(_conv.strideY, _conv.strideX) << "-" << _conv.group;
-            if (_deconvolution32f.Enable())
-                desc << " " << _deconvolution32f.Info();
-            this->UsePerfStat(desc.str(), Flop());
+        };
+
+        Epilogue GetEpilogue(const float* norm, const float* bias) const
+        {
+            Epilogue epilogue;
+            epilogue.norm = norm;
+            epilogue.bias = bias;
+            epilogue.slope = _conv.activation == ActivationFunctionTypePrelu ? this->Weight().back().CpuData() : NULL;
+            epilogue.params = _params;
+            epilogue.activation = _conv.activation;
+            epilogue.dst = NULL;
+            return epilogue;
         }
 
-    protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             ForwardCpu(src[0]->CpuData(), buf[TensorType32f*BUFFER_COUNT]->CpuData(), dst[0]->CpuData());
@@ -188,34 +274,37 @@ namespace Synet
         {
             if (_deconvolution32f.Enable())
                 _deconvolution32f.Forward(src, buf, dst);
+            else if (_direct)
+            {
+                Epilogue epilogue = GetEpilogue(NULL, _biasTerm ? this->Weight()[1].CpuData() : NULL);
+                const Type* weight = this->Weight()[0].CpuData();
+                for (size_t n = 0; n < _num; ++n)
+                {
+                    epilogue.dst = dst;
+                    if (_trans)
+                        DeconvolutionDirectNhwc(src, _conv, weight, (const Type*)NULL, buf, epilogue);
+                    else
+                        DeconvolutionDirectNchw(src, _conv, weight, (const Type*)NULL, buf, epilogue);
+                    src += _srcSize;
+                    dst += _dstSize;
+                }
+            }
             else
             {
                 const Type * weight = _transW ? _weightT.CpuData() : this->Weight()[0].CpuData();
                 for (size_t n = 0; n < _num; ++n)
                 {
-                    Type * tmp = _is1x1 ? dst : buf;
                     if (_trans)
                     {
                         assert(_conv.group == 1);// || _conv.group == _conv.srcC);
                         for (size_t g = 0; g < _conv.group; ++g)
-                            CpuGemm(CblasNoTrans, CblasNoTrans, _siS, _siD, _siW, Type(1), src + _grS * g, _ldS, weight + _grW * g, _ldW, Type(0), tmp + _grD * g, _ldD);
+                            CpuGemm(CblasNoTrans, CblasNoTrans, _siS, _siD, _siW, Type(1), src + _grS * g, _ldS, weight + _grW * g, _ldW, Type(0), dst + _grD * g, _ldD);
                     }
                     else
                     {
                         for (size_t g = 0; g < _conv.group; ++g)
                             CpuGemm(_transW ? CblasNoTrans : CblasTrans, CblasNoTrans, _siD, _siS, _siW,
-                                Type(1), weight + _grW * g, _ldW, src + _grS * g, _ldS, Type(0), tmp + _grD * g, _ldD);
-                    }
-                    if (!_is1x1)
-                    {
-                        if (_trans)
-                        {
-                            Synet::RowToImg(tmp, _conv.dstH, _conv.dstW, _conv.dstC, _conv.kernelY, _conv.kernelX,
-                                _conv.padY, _conv.padX, _conv.padH, _conv.padW, _conv.strideY, _conv.strideX, _conv.dilationY, _conv.dilationX, _conv.group, (const Type*)NULL, dst);
-                        }
-                        else
-                            Synet::ColToImg(tmp, _conv.dstC, _conv.dstH, _conv.dstW, _conv.kernelY, _conv.kernelX,
-                                _conv.padY, _conv.padX, _conv.padH, _conv.padW, _conv.strideY, _conv.strideX, _conv.dilationY, _conv.dilationX, (const Type*)NULL, dst);
+                                Type(1), weight + _grW * g, _ldW, src + _grS * g, _ldS, Type(0), dst + _grD * g, _ldD);
                     }
                     if (_biasTerm)
                         CpuAddBias(this->Weight()[1].CpuData(), _conv.dstC, _conv.dstH*_conv.dstW, dst, _trans);
@@ -253,8 +342,7 @@ namespace Synet
             }
         }
 
-    private:
-        bool _is1x1, _biasTerm, _transW;
+        bool _is1x1, _biasTerm, _transW, _direct;
         int _trans, _internal;
         ConvParam _conv;
         size_t _axis, _num, _srcSize, _dstSize, _ldW, _ldS, _ldD, _grW, _grS, _grD, _siW, _siS, _siD;
@@ -77,7 +77,9 @@ namespace Synet
         {
             return Base::MemoryUsage() +
                 _priorBboxes.size() * sizeof(NormalizedBBox) +
-                _priorVariances.size() * sizeof(float*);
+                _priorVariances.size() * sizeof(float*) +
+                _boxes.size() * (_boxes.empty() ? 0 : _boxes[0].MemoryUsage()) +
+                _decoded.capacity();
         }
 
         struct NormalizedBBox
@@ -98,7 +100,7 @@ namespace Synet
             }
         };
 
-        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst)
+        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst, size_t batch = 0)
         {
             //SYNET_PERF_FUNC();
             dst.clear();
@@ -106,7 +108,7 @@ namespace Synet
             size_t count = src[0]->Axis(2);
             for (size_t i = 0; i < count; ++i)
             {
-                if (pSrc[2] > threshold)
+                if (pSrc[2] > threshold && pSrc[0] == Type(batch))
                 {
                     Region r;
                     r.id = (size_t)pSrc[1];
@@ -128,89 +130,48 @@ namespace Synet
             const Type * pConf = src[1]->CpuData();
             size_t num = src[0]->Axis(0);
 
-            GetLocPredictions(pLoc, num, _numPriors, _numLocClasses, _shareLocation, _allLocPreds);
-
-            GetConfidenceScores(pConf, num, _numPriors, _numClasses, _allConfScores, false);
-
-            if (_keepMaxClassScoresOnly)
-            {
-                for (size_t i = 0; i < num; ++i) 
-                {
-                    LabelPred & labelScores = _allConfScores[i];
-                    for (size_t p = 0; p < _numPriors; ++p)
-                    {
-                        float maxScore = 0.0f;
-                        int maxScoreIdx = -1;
-                        for (size_t c = 0; c < _numClasses; ++c)
-                        {
-                            if (labelScores[(int)c][p] >= maxScore && c != _backgroundLabelId)
-                            {
-                                maxScoreIdx = (int)c;
-                                maxScore = labelScores[(int)c][p];
-                            }
-                        }
-                        for (size_t c = 0; c < _numClasses; ++c)
-                            if (c != maxScoreIdx && c != _backgroundLabelId)
-                                labelScores[(int)c][p] = 0.0f;
-                    }
-                }
-            }
-
-            DecodeBBoxesAll(_allLocPreds, _priorBboxes, _priorVariances, num, _shareLocation, _numLocClasses,
-                _backgroundLabelId, _codeType, _varianceEncodedInTarget, _clip, _allDecodeBboxes);
+            _boxes.resize(_numLocClasses);
+            for (size_t l = 0; l < _numLocClasses; ++l)
+                _boxes[l].Resize(num * _numPriors);
+            _decoded.assign(num * _numLocClasses * _numPriors, 0);
+            _indices.resize(num * _numClasses);
 
             size_t numKept = 0;
-            IndexMaps allIndices;
-            for (size_t i = 0; i < num; ++i) 
+            for (size_t i = 0; i < num; ++i)
             {
-                const LabelBBox & decodeBboxes = _allDecodeBboxes[i];
-                const LabelPred & confScores = _allConfScores[i];
-                IndexMap indices;
+                ScoreIndeces * indices = _indices.data() + i * _numClasses;
+                GetCandidates(pConf + i * _numPriors * _numClasses);
                 size_t numDet = 0;
                 for (size_t c = 0; c < _numClasses; ++c)
                 {
-                    if (c == _backgroundLabelId)
+                    indices[c].clear();
+                    if ((ptrdiff_t)c == _backgroundLabelId)
                         continue;
-                    assert(confScores.find((int)c) != confScores.end());
-                    const Floats & scores = confScores.find((int)c)->second;
-                    int label = _shareLocation ? -1 : (int)c;
-                    assert(decodeBboxes.find(label) != decodeBboxes.end());
-                    const NormalizedBBoxes & bboxes = decodeBboxes.find(label)->second;
-                    ApplyNMSFast(bboxes, scores, _confidenceThreshold, _nmsThreshold, _eta, _topK, indices[(int)c]);
-                    numDet += indices[(int)c].size();
+                    size_t l = _shareLocation ? 0 : c;
+                    DecodeCandidates(pLoc, i, l, _candidates[c]);
+                    ApplyNms(_boxes[l], i * _numPriors, _candidates[c], indices[c]);
+                    numDet += indices[c].size();
                 }
                 if (_keepTopK > -1 && numDet > (size_t)_keepTopK)
                 {
                     ScoreIndexPairs scoreIndexPairs;
-                    for (IndexMap::iterator it = indices.begin(); it != indices.end(); ++it) 
-                    {
-                        int label = it->first;
-                        const Index & labelIndices = it->second;
-                        assert(confScores.find(label) != confScores.end());
-                        const Floats & scores = confScores.find(label)->second;
-                        for (size_t j = 0; j < labelIndices.size(); ++j) 
-                        {
-                            size_t idx = labelIndices[j];
-                            scoreIndexPairs.push_back(ScoreIndexPair(scores[idx], IndexPair(label, idx)));
-                        }
-                    }
+                    for (size_t c = 0; c < _numClasses; ++c)
+                        for (size_t j = 0; j < indices[c].size(); ++j)
+                            scoreIndexPairs.push_back(ScoreIndexPair(indices[c][j].first, IndexPair(c, indices[c][j].second)));
                     std::sort(scoreIndexPairs.begin(), scoreIndexPairs.end(), [](const ScoreIndexPair & a, const ScoreIndexPair & b) { return a.first > b.first; });
                     scoreIndexPairs.resize(_keepTopK);
-                    IndexMap newIndices;
+                    for (size_t c = 0; c < _numClasses; ++c)
+                        indices[c].clear();
                     for (size_t j = 0; j < scoreIndexPairs.size(); ++j)
                     {
                         size_t label = scoreIndexPairs[j].second.first;
                         size_t idx = scoreIndexPairs[j].second.second;
-                        newIndices[(int)label].push_back(idx);
+                        indices[label].push_back(ScoreIndex(scoreIndexPairs[j].first, idx));
                     }
-                    allIndices.push_back(newIndices);
                     numKept += _keepTopK;
                 }
-                else 
-                {
-                    allIndices.push_back(indices);
+                else
                     numKept += numDet;
-                }
             }
 
             Shape shape(2, 1);
@@ -235,52 +196,60 @@ namespace Synet
                 pDst = dst[0]->CpuData();
             }
 
-            size_t count = 0;
             for (size_t i = 0; i < num; ++i) 
             {
-                const LabelPred & confScores = _allConfScores[i];
-                const LabelBBox & decodeBboxes = _allDecodeBboxes[i];
-                for (IndexMap::iterator it = allIndices[i].begin(); it != allIndices[i].end(); ++it) 
+                const ScoreIndeces * indices = _indices.data() + i * _numClasses;
+                for (size_t c = 0; c < _numClasses; ++c)
                 {
-                    int label = it->first;
-                    assert(confScores.find(label) != confScores.end());
-                    const Floats & scores = confScores.find(label)->second;
-                    int locLabel = _shareLocation ? -1 : label;
-                    assert(decodeBboxes.find(locLabel) != decodeBboxes.end());
-                    const NormalizedBBoxes & bboxes = decodeBboxes.find(locLabel)->second;
-                    Index & indices = it->second;
-                    for (size_t j = 0; j < indices.size(); ++j) 
+                    const Boxes & boxes = _boxes[_shareLocation ? 0 : c];
+                    for (size_t j = 0; j < indices[c].size(); ++j) 
                     {
-                        size_t idx = indices[j];
-                        pDst[count * 7 + 0] = Type(i);
-                        pDst[count * 7 + 1] = Type(label);
-                        pDst[count * 7 + 2] = scores[idx];
-                        const NormalizedBBox & bbox = bboxes[idx];
-                        pDst[count * 7 + 3] = bbox.xmin;
-                        pDst[count * 7 + 4] = bbox.ymin;
-                        pDst[count * 7 + 5] = bbox.xmax;
-                        pDst[count * 7 + 6] = bbox.ymax;
-                        ++count;
+                        size_t idx = i * _numPriors + indices[c][j].second;
+                        pDst[0] = Type(i);
+                        pDst[1] = Type(c);
+                        pDst[2] = indices[c][j].first;
+                        pDst[3] = boxes.xmin[idx];
+                        pDst[4] = boxes.ymin[idx];
+                        pDst[5] = boxes.xmax[idx];
+                        pDst[6] = boxes.ymax[idx];
+                        pDst += 7;
                     }
                 }
             }
         }
     private:
         typedef typename Base::Tensor Tensor;
-        typedef std::map<int, std::vector<NormalizedBBox>> LabelBBox;
-        typedef std::vector<LabelBBox> LabelBBoxes;
-        typedef std::map<int, Floats> LabelPred;
-        typedef std::vector<LabelPred> LabelPreds;
         typedef std::vector<NormalizedBBox> NormalizedBBoxes;
         typedef std::vector<Type*> Variances;
-        typedef std::map<int, Index> IndexMap;
-        typedef std::vector<IndexMap> IndexMaps;
         typedef std::pair<float, size_t> ScoreIndex;
         typedef std::vector<ScoreIndex> ScoreIndeces;
+        typedef std::vector<ScoreIndeces> ScoreIndecesVector;
         typedef std::pair<size_t, size_t> IndexPair;
         typedef std::pair<float, IndexPair> ScoreIndexPair;
         typedef std::vector<ScoreIndexPair> ScoreIndexPairs;
 
+        struct Boxes
+        {
+            Floats xmin, ymin, xmax, ymax, size;
+
+            void Resize(size_t count)
+            {
+                xmin.resize(count);
+                ymin.resize(count);
+                xmax.resize(count);
+                ymax.resize(count);
+                size.resize(count);
+            }
+
+            size_t MemoryUsage() const
+            {
+                return xmin.capacity() * 5 * sizeof(float);
+            }
+        };
+        typedef std::vector<Boxes> BoxesVector;
+
+        static const size_t TILE = 16;
+
         bool _shareLocation, _varianceEncodedInTarget, _keepMaxClassScoresOnly, _clip;
         size_t _numClasses, _numLocClasses, _numPriors;
         ptrdiff_t _backgroundLabelId, _keepTopK, _topK;
@@ -288,69 +257,135 @@ namespace Synet
         float _confidenceThreshold, _nmsThreshold, _eta;
         NormalizedBBoxes _priorBboxes;
         Variances _priorVariances;
-        LabelBBoxes _allLocPreds, _allDecodeBboxes;
-        LabelPreds _allConfScores;
+        BoxesVector _boxes;
+        Boxes _kept;
+        Bytes _decoded;
+        ScoreIndecesVector _candidates, _indices;
 
-        void GetLocPredictions(const Type * pLoc, size_t num, size_t numPredsPerClass, size_t numLocClasses, bool shareLocation, LabelBBoxes & locPreds)
+        void GetCandidates(const Type * pConf)
         {
-            locPreds.resize(num);
-            for (size_t i = 0; i < num; ++i) 
+            _candidates.resize(_numClasses);
+            for (size_t c = 0; c < _numClasses; ++c)
+                _candidates[c].clear();
+            for (size_t p = 0; p < _numPriors; ++p, pConf += _numClasses)
             {
-                LabelBBox & labelBbox = locPreds[i];
-                for (size_t c = 0; c < numLocClasses; ++c)
+                ptrdiff_t maxScoreIdx = -1;
+                if (_keepMaxClassScoresOnly)
                 {
-                    int label = shareLocation ? -1 : (int)c;
-                    if (labelBbox.find(label) == labelBbox.end())
-                        labelBbox[label].resize(numPredsPerClass);
-                    std::vector<NormalizedBBox>& bBoxes = labelBbox[label];
-                    for (size_t p = 0; p < numPredsPerClass; ++p)
+                    float maxScore = 0.0f;
+                    for (size_t c = 0; c < _numClasses; ++c)
                     {
-                        size_t startIdx = p * numLocClasses * 4;
-                        bBoxes[p].xmin = pLoc[startIdx + c * 4 + 0];
-                        bBoxes[p].ymin = pLoc[startIdx + c * 4 + 1];
-                        bBoxes[p].xmax = pLoc[startIdx + c * 4 + 2];
-                        bBoxes[p].ymax = pLoc[startIdx + c * 4 + 3];
+                        if (pConf[c] >= maxScore && (ptrdiff_t)c != _backgroundLabelId)
+                        {
+                            maxScoreIdx = (ptrdiff_t)c;
+                            maxScore = pConf[c];
+                        }
                     }
                 }
-                pLoc += numPredsPerClass * numLocClasses * 4;
+                for (size_t c = 0; c < _numClasses; ++c)
+                {
+                    if ((ptrdiff_t)c == _backgroundLabelId)
+                        continue;
+                    float score = pConf[c];
+                    if (_keepMaxClassScoresOnly && (ptrdiff_t)c != maxScoreIdx)
+                        score = 0.0f;
+                    if (score > _confidenceThreshold)
+                        _candidates[c].push_back(ScoreIndex(score, p));
+                }
             }
+            for (size_t c = 0; c < _numClasses; ++c)
+                SortCandidates(_candidates[c]);
         }
 
-        void GetConfidenceScores(const Type * pConf, size_t num, size_t numPredsPerClass, size_t numClasses, LabelPreds & confPreds, bool keepMaxScoreOnly)
+        void SortCandidates(ScoreIndeces & candidates)
         {
-            confPreds.resize(num);
-            for (size_t i = 0; i < num; ++i) 
+            auto greater = [](const ScoreIndex & a, const ScoreIndex & b)
             {
-                LabelPred & labelScores = confPreds[i];
-                std::vector<float*> scores(numClasses);
-                for (size_t c = 0; c < numClasses; ++c)
-                {
-                    labelScores[(int)c].resize(numPredsPerClass);
-                    scores[c] = labelScores[(int)c].data();
-                }
-                for (size_t p = 0; p < numPredsPerClass; ++p)
+                return a.first > b.first || (a.first == b.first && a.second < b.second);
+            };
+            if (_topK > -1 && (size_t)_topK < candidates.size())
+            {
+                std::nth_element(candidates.begin(), candidates.begin() + _topK, candidates.end(), greater);
+                candidates.resize(_topK);
+            }
+            std::sort(candidates.begin(), candidates.end(), greater);
+        }
+
+        void DecodeCandidates(const Type * pLoc, size_t image, size_t locClass, const ScoreIndeces & candidates)
+        {
+            Boxes & boxes = _boxes[locClass];
+            uint8_t * decoded = _decoded.data() + (image * _numLocClasses + locClass) * _numPriors;
+            pLoc += image * _numPriors * _numLocClasses * 4;
+            for (size_t i = 0; i < candidates.size(); ++i)
+            {
+                size_t p = candidates[i].second;
+                if (decoded[p])
+                    continue;
+                const Type * loc = pLoc + (p * _numLocClasses + locClass) * 4;
+                NormalizedBBox bbox, decodeBbox;
+                bbox.xmin = loc[0];
+                bbox.ymin = loc[1];
+                bbox.xmax = loc[2];
+                bbox.ymax = loc[3];
+                DecodeBBox(_priorBboxes[p], _priorVariances[p], _codeType, _varianceEncodedInTarget, _clip, bbox, decodeBbox);
+                size_t idx = image * _numPriors + p;
+                boxes.xmin[idx] = decodeBbox.xmin;
+                boxes.ymin[idx] = decodeBbox.ymin;
+                boxes.xmax[idx] = decodeBbox.xmax;
+                boxes.ymax[idx] = decodeBbox.ymax;
+                boxes.size[idx] = BBoxSize(decodeBbox);
+                decoded[p] = 1;
+            }
+        }
+
+        void ApplyNms(const Boxes & boxes, size_t offset, const ScoreIndeces & candidates, ScoreIndeces & indices)
+        {
+            float adaptiveThreshold = _nmsThreshold;
+            _kept.Resize(candidates.size());
+            size_t kept = 0;
+            for (size_t i = 0; i < candidates.size(); ++i)
+            {
+                size_t idx = offset + candidates[i].second;
+                if (Overlapped(boxes.xmin[idx], boxes.ymin[idx], boxes.xmax[idx], boxes.ymax[idx], boxes.size[idx], kept, adaptiveThreshold))
+                    continue;
+                _kept.xmin[kept] = boxes.xmin[idx];
+                _kept.ymin[kept] = boxes.ymin[idx];
+                _kept.xmax[kept] = boxes.xmax[idx];
+                _kept.ymax[kept] = boxes.ymax[idx];
+                _kept.size[kept] = boxes.size[idx];
+                kept++;
+                indices.push_back(candidates[i]);
+                if (_eta < 1 && adaptiveThreshold > 0.5)
+                    adaptiveThreshold *= _eta;
+            }
+        }
+
+        bool Overlapped(float xmin, float ymin, float xmax, float ymax, float size, size_t kept, float threshold) const
+        {
+            const float * kxmin = _kept.xmin.data();
+            const float * kymin = _kept.ymin.data();
+            const float * kxmax = _kept.xmax.data();
+            const float * kymax = _kept.ymax.data();
+            const float * ksize = _kept.size.data();
+            int empty = !(0.0f <= threshold);
+            for (size_t k = 0; k < kept; k += TILE)
+            {
+                size_t end = Min(kept, k + TILE);
+                int overlapped = 0;
+                for (size_t j = k; j < end; ++j)
                 {
-                    size_t startIdx = p * numClasses;
-                    size_t maxClassScoreIdx = 0;
-                    float maxClassScore = 0;
-                    for (size_t c = 0; c < numClasses; ++c)
-                    {
-                        scores[c][p] = pConf[startIdx + c];
-                        if (pConf[startIdx + c] >= maxClassScore)
-                        {
-                            maxClassScoreIdx = c;
-                            maxClassScore = pConf[startIdx + c];
-                        }
-                    }
-                    if (keepMaxScoreOnly)
-                    {
-                        for (size_t c = 0; c < numClasses; ++c)
-                            if (c != maxClassScoreIdx)
-                                scores[c][p] = 0.0f;
-                    }
+                    int disjoint = (kxmin[j] > xmax) | (kxmax[j] < xmin) | (kymin[j] > ymax) | (kymax[j] < ymin);
+                    float w = Min(xmax, kxmax[j]) - Max(xmin, kxmin[j]);
+                    float h = Min(ymax, kymax[j]) - Max(ymin, kymin[j]);
+                    float s = w * h;
+                    float overlap = s / (size + ksize[j] - s);
+                    int intersect = (1 - disjoint) & (w > 0) & (h > 0);
+                    overlapped |= (intersect & !(overlap <= threshold)) | ((1 - intersect) & empty);
                 }
-                pConf += numPredsPerClass * numClasses;
+                if (overlapped)
+                    return true;
             }
+            return false;
         }
 
         void GetPriorBBoxes(const Type * pPrior, size_t numPriors, NormalizedBBoxes & priorBboxes, Variances & priorVariances)
@@ -465,121 +500,5 @@ namespace Synet
             if (clipBbox)
                 ClipBBox(decodeBbox, decodeBbox);
         }
-
-        void DecodeBBoxes(const NormalizedBBoxes & priorBboxes, const Variances & priorVariances, 
-            PriorBoxCodeType codeType, bool varianceEncodedInTarget, bool clipBbox, 
-            const NormalizedBBoxes & bboxes, NormalizedBBoxes & decodeBboxes) 
-        {
-            size_t numBboxes = priorBboxes.size();
-            decodeBboxes.resize(numBboxes);
-            for (size_t i = 0; i < numBboxes; ++i) 
-                DecodeBBox(priorBboxes[i], priorVariances[i], codeType, varianceEncodedInTarget, clipBbox, bboxes[i], decodeBboxes[i]);
-        }
-
-        void DecodeBBoxesAll(const LabelBBoxes & allLocPreds, const NormalizedBBoxes & priorBboxes, const Variances & priorVariances, 
-            size_t num, bool shareLocation, size_t numLocClasses, size_t backgroundLabelId, 
-            PriorBoxCodeType codeType, bool varianceEncodedInTarget, bool clip, LabelBBoxes & allDecodeBboxes)
-        {
-            allDecodeBboxes.resize(num);
-            for (size_t i = 0; i < num; ++i) 
-            {
-                LabelBBox & decodeBboxes = allDecodeBboxes[i];
-                for (size_t c = 0; c < numLocClasses; ++c) 
-                {
-                    int label = shareLocation ? -1 : (int)c;
-                    if (label == backgroundLabelId)
-                        continue;
-                    assert(allLocPreds[i].find(label) != allLocPreds[i].end());
-                    const NormalizedBBoxes & labelLocPreds = allLocPreds[i].find(label)->second;
-                    DecodeBBoxes(priorBboxes, priorVariances, codeType, varianceEncodedInTarget, clip, labelLocPreds, decodeBboxes[label]);
-                }
-            }
-        }
-
-        void GetMaxScoreIndex(const Floats & scores, float threshold, ptrdiff_t topK, ScoreIndeces & scoreIndeces)
-        {
-            scoreIndeces.clear();
-            for (size_t i = 0; i < scores.size(); ++i) 
-            {
-                if (scores[i] > threshold)
-                    scoreIndeces.push_back(ScoreIndex(scores[i], i));
-            }
-            std::stable_sort(scoreIndeces.begin(), scoreIndeces.end(), [](const ScoreIndex & a, const ScoreIndex & b) { return a.first > b.first; });
-            if (topK > -1 && (size_t)topK < scoreIndeces.size())
-                scoreIndeces.resize(topK);
-        }
-
-        void IntersectBBox(const NormalizedBBox & bbox1, const NormalizedBBox & bbox2, NormalizedBBox & intersect) 
-        {
-            if (bbox2.xmin > bbox1.xmax || bbox2.xmax < bbox1.xmin || bbox2.ymin > bbox1.ymax || bbox2.ymax < bbox1.ymin)
-            {
-                intersect.xmin = 0;
-                intersect.ymin = 0;
-                intersect.xmax = 0;
-                intersect.ymax = 0;
-            }
-            else 
-            {
-                intersect.xmin = Max(bbox1.xmin, bbox2.xmin);
-                intersect.ymin = Max(bbox1.ymin, bbox2.ymin);
-                intersect.xmax = Min(bbox1.xmax, bbox2.xmax);
-                intersect.ymax = Min(bbox1.ymax, bbox2.ymax);
-            }
-        }
-
-        float JaccardOverlap(const NormalizedBBox & bbox1, const NormalizedBBox & bbox2, bool normalized) 
-        {
-            NormalizedBBox intersect;
-            IntersectBBox(bbox1, bbox2, intersect);
-            float intersectW, intersectH;
-            if (normalized) 
-            {
-                intersectW = intersect.xmax - intersect.xmin;
-                intersectH = intersect.ymax - intersect.ymin;
-            }
-            else 
-            {
-                intersectW = intersect.xmax - intersect.xmin + 1;
-                intersectH = intersect.ymax - intersect.ymin + 1;
-            }
-            if (intersectW > 0 && intersectH > 0) 
-            {
-                float intersectS = intersectW * intersectH;
-                float bbox1Size = BBoxSize(bbox1);
-                float bbox2Size = BBoxSize(bbox2);
-                return intersectS / (bbox1Size + bbox2Size - intersectS);
-            }
-            else
-                return 0;
-        }
-
-        void ApplyNMSFast(const NormalizedBBoxes & bboxes, const Floats & scores, float scoreThreshold, float nmsThreshold, float eta, ptrdiff_t topK, Index & indices)
-        {
-            ScoreIndeces scoreIndeces;
-            GetMaxScoreIndex(scores, scoreThreshold, topK, scoreIndeces);
-            float adaptiveThreshold = nmsThreshold;
-            indices.clear();
-            while (scoreIndeces.size() != 0)
-            {
-                size_t idx = scoreIndeces.front().second;
-                bool keep = true;
-                for (int k = 0; k < indices.size(); ++k) 
-                {
-                    if (keep)
-                    {
-                        size_t keptIdx = indices[k];
-                        float overlap = JaccardOverlap(bboxes[idx], bboxes[keptIdx], true);
-                        keep = overlap <= adaptiveThreshold;
-                    }
-                    else
-                        break;
-                }
-                if (keep)
-                    indices.push_back(idx);
-                scoreIndeces.erase(scoreIndeces.begin());
-                if (keep && eta < 1 && adaptiveThreshold > 0.5)
-                    adaptiveThreshold *= eta;
-            }
-        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,487 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Layer.h"
+#include "Synet/Utils/Activation.h"
+#include "Synet/Layers/HswishLayer.h"
+
+namespace Synet
+{
+    namespace Detail
+    {
+        class ElementwiseView
+        {
+        public:
+            void Init(const Shape & dst, const Shape & src)
+            {
+                assert(dst.size() == src.size());
+                _shape.clear();
+                _steps.clear();
+                for (size_t i = 0, step = 1; i < dst.size(); ++i)
+                {
+                    size_t axis = dst.size() - 1 - i;
+                    assert(src[axis] == dst[axis] || src[axis] == 1);
+                    if (dst[axis] == 1)
+                        continue;
+                    size_t curr = src[axis] == 1 ? 0 : step;
+                    if (_shape.size() && _steps.back() * _shape.back() == curr)
+                        _shape.back() *= dst[axis];
+                    else
+                    {
+                        _shape.push_back(dst[axis]);
+                        _steps.push_back(curr);
+                    }
+                    step *= src[axis];
+                }
+                if (_shape.empty())
+                {
+                    _shape.push_back(1);
+                    _steps.push_back(1);
+                }
+                std::reverse(_shape.begin(), _shape.end());
+                std::reverse(_steps.begin(), _steps.end());
+                assert(_shape.size() <= 8);
+                _direct = _shape.size() == 1 && _steps[0] == 1;
+            }
+
+            template<class T> const T * Load(const T * src, size_t offset, size_t size, T * buf) const
+            {
+                if (_direct)
+                    return src + offset;
+                size_t index[8], last = _shape.size() - 1, pos = 0;
+                for (size_t i = 0, rest = offset; i <= last; ++i)
+                {
+                    index[last - i] = rest % _shape[last - i];
+                    rest /= _shape[last - i];
+                    pos += index[last - i] * _steps[last - i];
+                }
+                size_t step = _steps[last];
+                for (size_t i = 0; i < size;)
+                {
+                    size_t n = Min(_shape[last] - index[last], size - i);
+                    if (step == 0)
+                    {
+                        for (size_t j = 0; j < n; ++j)
+                            buf[i + j] = src[pos];
+                    }
+                    else if (step == 1)
+                        memcpy(buf + i, src + pos, n * sizeof(T));
+                    else
+                    {
+                        for (size_t j = 0; j < n; ++j)
+                            buf[i + j] = src[pos + j * step];
+                    }
+                    i += n;
+                    pos += n * step;
+                    index[last] += n;
+                    for (size_t d = last; d > 0 && index[d] == _shape[d]; --d)
+                    {
+                        pos -= index[d] * _steps[d];
+                        index[d] = 0;
+                        index[d - 1]++;
+                        pos += _steps[d - 1];
+                    }
+                }
+                return buf;
+            }
+
+        private:
+            Shape _shape, _steps;
+            bool _direct;
+        };
+
+        template <class T> void ElementwiseOperation(ElementwiseOpType type, const T * a, const T * b, const T * params, size_t size, T * dst)
+        {
+            switch (type)
+            {
+            case ElementwiseOpTypeAdd:
+                if (params[0] == T(1) && params[1] == T(1))
+                {
+                    for (size_t i = 0; i < size; ++i)
+                        dst[i] = a[i] + b[i];
+                }
+                else
+                {
+                    for (size_t i = 0; i < size; ++i)
+                        dst[i] = a[i] * params[0] + b[i] * params[1];
+                }
+                break;
+            case ElementwiseOpTypeSub:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = a[i] - b[i];
+                break;
+            case ElementwiseOpTypeMul:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = a[i] * b[i];
+                break;
+            case ElementwiseOpTypeDiv:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = a[i] / b[i];
+                break;
+            case ElementwiseOpTypeMax:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = Max(a[i], b[i]);
+                break;
+            case ElementwiseOpTypeMin:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = Min(a[i], b[i]);
+                break;
+            case ElementwiseOpTypePrelu:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = CpuRelu(a[i], b[i]);
+                break;
+            case ElementwiseOpTypeRelu:
+                CpuRelu(a, size, params[0], dst);
+                break;
+            case ElementwiseOpTypeSigmoid:
+                CpuSigmoid(a, size, dst);
+                break;
+            case ElementwiseOpTypeElu:
+                CpuElu(a, size, params[0], dst);
+                break;
+            case ElementwiseOpTypeHswish:
+                HswishLayerForwardCpu(a, size, params[0], params[1], dst);
+                break;
+            case ElementwiseOpTypeMish:
+                CpuMish(a, size, params[0], dst);
+                break;
+            case ElementwiseOpTypeSoftplus:
+                CpuSoftplus(a, size, params[0], params[1], dst);
+                break;
+            case ElementwiseOpTypeRestrictRange:
+                CpuRestrictRange(a, size, params[0], params[1], dst);
+                break;
+            case ElementwiseOpTypePower:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = ::pow(a[i] * params[1] + params[2], params[0]);
+                break;
+            case ElementwiseOpTypeAbs:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = Abs(a[i]);
+                break;
+            case ElementwiseOpTypeExp:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = ::exp(a[i]);
+                break;
+            case ElementwiseOpTypeLog:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = ::log(a[i]);
+                break;
+            case ElementwiseOpTypeNeg:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = -a[i];
+                break;
+            case ElementwiseOpTypeRsqrt:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = T(1) / ::sqrt(a[i]);
+                break;
+            case ElementwiseOpTypeSqrt:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = ::sqrt(a[i]);
+                break;
+            case ElementwiseOpTypeTanh:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = ::tanh(a[i]);
+                break;
+            case ElementwiseOpTypeZero:
+                ::memset(dst, 0, size * sizeof(T));
+                break;
+            default:
+                assert(0);
+            }
+        }
+    }
+
+    template <class T> class ElementwiseLayer : public Synet::Layer<T>
+    {
+    public:
+        typedef T Type;
+        typedef Layer<T> Base;
+        typedef typename Base::Tensor Tensor;
+        typedef typename Base::TensorPtrs TensorPtrs;
+
+        static const size_t TILE = 256;
+
+        ElementwiseLayer(const LayerParam & param, Context* context)
+            : Base(param, context)
+        {
+        }
+
+        virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+            const ElementwiseParam & param = this->Param().elementwise();
+            const Tensors & weight = this->Weight();
+            _srcs = src.size();
+            _weights = weight.size();
+            size_t base = 0;
+            for (size_t i = 1; i < src.size(); ++i)
+                if (src[i]->Count() > src[base]->Count() || (src[i]->Count() == src[base]->Count() && src[i]->Size() > src[base]->Size()))
+                    base = i;
+            const Shape & full = src[base]->Shape();
+            _format = src[base]->Format();
+            bool valid = true;
+            Shapes shapes(_srcs + _weights + param.op().size());
+            for (size_t i = 0; i < src.size(); ++i)
+                valid = valid && AlignShape(src[i]->Shape(), full, shapes[i]);
+            _ops.resize(param.op().size());
+            for (size_t o = 0; o < _ops.size(); ++o)
+            {
+                const ElementwiseOpParam & op = param.op()[o];
+                Op & curr = _ops[o];
+                curr.type = op.type();
+                curr.src[0] = op.src()[0];
+                curr.src[1] = op.src().size() > 1 ? op.src()[1] : op.src()[0];
+                for (size_t p = 0; p < 3; ++p)
+                    curr.params[p] = p < op.floats().size() ? op.floats()[p] : DefaultParam(op.type(), p);
+                Shape & shape = shapes[_srcs + _weights + o];
+                shape = shapes[curr.src[0]];
+                for (size_t s = 1; s < op.src().size() && valid; ++s)
+                {
+                    size_t reg = op.src()[s];
+                    if (reg >= _srcs && reg < _srcs + _weights)
+                        shapes[reg] = WeightShape(weight[reg - _srcs], shape, op.axis());
+                    valid = Broadcast(shape, shapes[reg], shape);
+                }
+            }
+            assert(valid);
+            _dstShape = shapes.back();
+            _dstSize = Detail::Size(_dstShape);
+
+            size_t tiles = 0, size = 0;
+            _main.loads.clear();
+            _main.ops.clear();
+            for (size_t o = 0; o < _ops.size(); ++o)
+            {
+                Op & curr = _ops[o];
+                const Shape & shape = shapes[_srcs + _weights + o];
+                curr.main = shape == _dstShape;
+                curr.size = Detail::Size(shape);
+                curr.offset = size;
+                if (curr.main)
+                {
+                    for (size_t s = 0; s < 2; ++s)
+                        AddLoad(_main, curr.src[s], shapes, _dstShape);
+                    _main.ops.push_back(o);
+                }
+                else
+                {
+                    curr.pass.loads.clear();
+                    curr.pass.ops.assign(1, o);
+                    for (size_t s = 0; s < 2; ++s)
+                        AddLoad(curr.pass, curr.src[s], shapes, shape);
+                    tiles = Max(tiles, curr.pass.loads.size() + 1);
+                    size += curr.size;
+                }
+            }
+            assert(_ops.size() && _ops.back().main);
+            tiles = Max(tiles, _main.loads.size() + _main.ops.size());
+            Base::Extend32f(buf, 0, Shp(tiles * TILE));
+            Base::Extend32f(buf, 1, Shp(Max<size_t>(size, 1)));
+            _data.resize(_srcs + _weights + _ops.size());
+            _tile.resize(_srcs + _weights + _ops.size());
+
+            bool inPlace = false;
+            for (size_t i = 0; i < src.size(); ++i)
+                inPlace = inPlace || src[i] == dst[0];
+            if (inPlace)
+                assert(dst[0]->Shape() == _dstShape);
+            else
+                dst[0]->Reshape(_dstShape, _format);
+            this->UsePerfStat();
+        }
+
+    protected:
+        virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
+        {
+            Type * tiles = Base::Buf32f(buf, 0);
+            Type * pre = Base::Buf32f(buf, 1);
+            for (size_t i = 0; i < _srcs; ++i)
+                _data[i] = src[i]->CpuData();
+            for (size_t i = 0; i < _weights; ++i)
+                _data[_srcs + i] = this->Weight()[i].CpuData();
+            for (size_t o = 0; o < _ops.size(); ++o)
+            {
+                if (!_ops[o].main)
+                {
+                    Run(_ops[o].pass, _ops[o].size, tiles, pre + _ops[o].offset);
+                    _data[_srcs + _weights + o] = pre + _ops[o].offset;
+                }
+            }
+            Run(_main, _dstSize, tiles, dst[0]->CpuData());
+        }
+
+    private:
+        typedef typename Base::Tensors Tensors;
+
+        struct Load
+        {
+            size_t reg;
+            Detail::ElementwiseView view;
+        };
+        typedef std::vector<Load> Loads;
+
+        struct Pass
+        {
+            Loads loads;
+            Index ops;
+        };
+
+        struct Op
+        {
+            ElementwiseOpType type;
+            size_t src[2], size, offset;
+            Type params[3];
+            bool main;
+            Pass pass;
+        };
+        typedef std::vector<Op> Ops;
+
+        size_t _srcs, _weights, _dstSize;
+        Shape _dstShape;
+        TensorFormat _format;
+        Ops _ops;
+        Pass _main;
+        std::vector<const Type*> _data, _tile;
+
+        void AddLoad(Pass & pass, size_t reg, const Shapes & shapes, const Shape & shape)
+        {
+            if (reg >= _srcs + _weights && std::find(pass.ops.begin(), pass.ops.end(), reg - _srcs - _weights) != pass.ops.end())
+                return;
+            for (size_t i = 0; i < pass.loads.size(); ++i)
+                if (pass.loads[i].reg == reg)
+                    return;
+            pass.loads.push_back(Load());
+            pass.loads.back().reg = reg;
+            pass.loads.back().view.Init(shape, shapes[reg]);
+        }
+
+        void Run(const Pass & pass, size_t size, Type * tiles, Type * dst)
+        {
+            for (size_t offset = 0; offset < size; offset += TILE)
+            {
+                size_t tile = Min(TILE, size - offset);
+                Type * buf = tiles;
+                for (size_t i = 0; i < pass.loads.size(); ++i, buf += TILE)
+                    _tile[pass.loads[i].reg] = pass.loads[i].view.Load(_data[pass.loads[i].reg], offset, tile, buf);
+                for (size_t i = 0; i < pass.ops.size(); ++i, buf += TILE)
+                {
+                    const Op & op = _ops[pass.ops[i]];
+                    Type * out = i + 1 == pass.ops.size() ? dst + offset : buf;
+                    Detail::ElementwiseOperation(op.type, _tile[op.src[0]], _tile[op.src[1]], op.params, tile, out);
+                    _tile[_srcs + _weights + pass.ops[i]] = out;
+                }
+            }
+        }
+
+        bool AlignShape(const Shape & shape, const Shape & full, Shape & aligned) const
+        {
+            if (shape.size() == full.size() && Broadcast(shape, full, aligned))
+            {
+                aligned = shape;
+                return true;
+            }
+            if (full.size() == 4 && shape.size())
+            {
+                bool trans = _format == TensorFormatNhwc;
+                size_t batch = full[0], channels = full[trans ? 3 : 1], spatial = full[trans ? 1 : 2] * full[trans ? 2 : 3];
+                size_t outer = shape.size() > 1 ? shape[0] : 1, size = Detail::Size(shape) / outer;
+                if (outer == 1 || outer == batch)
+                {
+                    aligned.assign(4, 1);
+                    aligned[0] = outer;
+                    if (size == channels)
+                    {
+                        aligned[trans ? 3 : 1] = channels;
+                        return true;
+                    }
+                    if (size == spatial)
+                    {
+                        aligned[trans ? 1 : 2] = full[trans ? 1 : 2];
+                        aligned[trans ? 2 : 3] = full[trans ? 2 : 3];
+                        return true;
+                    }
+                }
+            }
+            if (shape.size() > full.size())
+                return false;
+            Shape tmp(full.size(), 1);
+            for (size_t i = 0; i < shape.size(); ++i)
+                tmp[full.size() - shape.size() + i] = shape[i];
+            aligned = tmp;
+            return Broadcast(aligned, full, tmp);
+        }
+
+        Shape WeightShape(const Tensor & weight, const Shape & shape, size_t axis) const
+        {
+            if (weight.Size() == Detail::Size(shape))
+                return shape;
+            Shape aligned(shape.size(), 1);
+            if (weight.Size() == 1)
+                return aligned;
+            if (_format == TensorFormatNhwc)
+                aligned.back() = weight.Size();
+            else if (axis + weight.Count() > shape.size())
+                return weight.Shape();
+            else
+            {
+                for (size_t i = 0; i < weight.Count(); ++i)
+                    aligned[axis + i] = weight.Axis(i);
+            }
+            return aligned;
+        }
+
+        static bool Broadcast(const Shape & a, const Shape & b, Shape & dst)
+        {
+            if (a.size() != b.size())
+                return false;
+            Shape shape(a.size());
+            for (size_t i = 0; i < a.size(); ++i)
+            {
+                if (a[i] != b[i] && a[i] != 1 && b[i] != 1)
+                    return false;
+                shape[i] = Max(a[i], b[i]);
+            }
+            dst = shape;
+            return true;
+        }
+
+        static Type DefaultParam(ElementwiseOpType type, size_t index)
+        {
+            switch (type)
+            {
+            case ElementwiseOpTypeAdd: return Type(1);
+            case ElementwiseOpTypeElu: return Type(1);
+            case ElementwiseOpTypeHswish: return index ? Type(1.0f / 6.0f) : Type(3);
+            case ElementwiseOpTypeMish: return Type(20);
+            case ElementwiseOpTypeSoftplus: return index ? Type(20) : Type(1);
+            case ElementwiseOpTypeRestrictRange: return index ? Type(FLT_MAX) : Type(-FLT_MAX);
+            case ElementwiseOpTypePower: return index == 2 ? Type(0) : Type(1);
+            default: return Type(0);
+            }
+        }
+    };
+}
@@ -147,10 +147,7 @@ namespace Synet
             {
                 _src.resize(src.size());
                 for (size_t i = 0; i < src.size(); ++i)
-                {
                     assert(src[i]->Size() == src[0]->Size());
-                    _src[i] = src[i]->CpuData();
-                }
                 _batch = 1, _channels = 1, _spatial = src[0]->Size();
             }
             if(dst[0] != src[0])
@@ -199,6 +196,8 @@ namespace Synet
             }
             else
             {
+                for (size_t i = 0; i < src.size(); ++i)
+                    _src[i] = src[i]->CpuData();
                 Detail::EltwiseLayerForwardCpu(_src.data(), _coefficients.data(), _src.size(), dst[0]->Size(), _operation, dst[0]->CpuData());
             }
         }
@@ -41,6 +41,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             assert(src[0] != dst[0]);
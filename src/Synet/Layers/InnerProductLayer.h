@@ -105,6 +105,12 @@ namespace Synet
                 _weight8i.MemoryUsage() + _norm32i.MemoryUsage() + _norm32f.MemoryUsage();
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _innerProduct32f.Share(((const InnerProductLayer&)layer)._innerProduct32f);
+        }
+
         virtual void CompactWeight()
         {
             if (_is8i || _internal)
@@ -26,7 +26,7 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
-#include "Synet/Layers/Interp2Layer.h"
+#include "Synet/Layers/InterpLayer.h"
 
 namespace Synet
 {
@@ -52,22 +52,22 @@ namespace Synet
                     const float h1r = rh * h2;
                     const int h1 = (int)h1r;
                     const int h1p = (h1 < sizeH - 1) ? channels : 0;
-                    const T h1lambda = h1r - h1;
-                    const T h0lambda = T(1.) - h1lambda;
+                    const float h1lambda = h1r - h1;
+                    const float h0lambda = 1.0f - h1lambda;
                     for (int w2 = 0; w2 < dstW; ++w2)
                     {
                         const float w1r = rw * w2;
                         const int w1 = (int)w1r;
                         const int w1p = (w1 < sizeW - 1) ? channels : 0;
-                        const T w1lambda = w1r - w1;
-                        const T w0lambda = T(1.) - w1lambda;
+                        const float w1lambda = w1r - w1;
+                        const float w0lambda = 1.0f - w1lambda;
                         const T* pos1 = &src[(h1 * srcW + w1) * channels];
                         T* pos2 = &dst[(h2 * dstW + w2) * channels];
                         for (int c = 0; c < channels; ++c)
                         {
-                            pos2[0] =
+                            pos2[0] = InterpCast<T>(
                                 h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p]) +
-                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]);
+                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]));
                             pos1 += 1;
                             pos2 += 1;
                         }
@@ -92,22 +92,22 @@ namespace Synet
                     const float h1r = rh * h2;
                     const int h1 = (int)h1r;
                     const int h1p = (h1 < sizeH - 1) ? 1 : 0;
-                    const T h1lambda = h1r - h1;
-                    const T h0lambda = T(1.) - h1lambda;
+                    const float h1lambda = h1r - h1;
+                    const float h0lambda = 1.0f - h1lambda;
                     for (int w2 = 0; w2 < dstW; ++w2)
                     {
                         const float w1r = rw * w2;
                         const int w1 = (int)w1r;
                         const int w1p = (w1 < sizeW - 1) ? 1 : 0;
-                        const T w1lambda = w1r - w1;
-                        const T w0lambda = T(1.) - w1lambda;
+                        const float w1lambda = w1r - w1;
+                        const float w0lambda = 1.0f - w1lambda;
                         const T * pos1 = &src[h1 * srcW + w1];
                         T * pos2 = &dst[h2 * dstW + w2];
                         for (int c = 0; c < channels; ++c)
                         {
-                            pos2[0] =
+                            pos2[0] = InterpCast<T>(
                                 h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p]) +
-                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]);
+                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]));
                             pos1 += srcH * srcW;
                             pos2 += dstH * dstW;
                         }
@@ -116,31 +116,6 @@ namespace Synet
             }
         }
 
-
-#if defined(SYNET_SIMD_LIBRARY_ENABLE)
-        template <> inline void Interp2LayerForwardCpuBilinear<float>(size_t channels, const float * src, size_t srcH, size_t srcW, size_t sizeH, size_t sizeW, float * dst, size_t dstH, size_t dstW, int alignCorners, int trans)
-        {
-            SimdResizeMethodType method = alignCorners ? ::SimdResizeMethodCaffeInterp : ::SimdResizeMethodInferenceEngineInterp;
-            if (trans)
-            {
-                void * resizer = ::SimdResizerInit(sizeW, sizeH, dstW, dstH, channels, ::SimdResizeChannelFloat, method);
-                ::SimdResizerRun(resizer, (uint8_t*)src, channels * srcW * sizeof(float), (uint8_t*)dst, channels * dstW * sizeof(float));
-                ::SimdRelease(resizer);
-            }
-            else
-            {
-                void * resizer = ::SimdResizerInit(sizeW, sizeH, dstW, dstH, 1, ::SimdResizeChannelFloat, method);
-                for (size_t c = 0; c < channels; ++c)
-                {
-                    ::SimdResizerRun(resizer, (uint8_t*)src, srcW * sizeof(float), (uint8_t*)dst, dstW * sizeof(float));
-                    src += srcH * srcW;
-                    dst += dstH * dstW;
-                }
-                ::SimdRelease(resizer);            
-            }
-        }
-#endif
-
         template <typename T> void Interp2LayerForwardCpu(size_t channels, const T * src, size_t srcH, size_t srcW, size_t padY, size_t padX, size_t padH, size_t padW, T * dst, size_t dstH, size_t dstW, int alignCorners, int trans)
         {
             size_t sizeH = srcH - padY - padH;
@@ -165,6 +140,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const Interp2Param & param = this->Param().interp2();
@@ -190,6 +170,9 @@ namespace Synet
             _channels = _trans ? src[0]->Axis(3) : src[0]->Axis(1);
             _srcH = _trans ? src[0]->Axis(1) : src[0]->Axis(2);
             _srcW = _trans ? src[0]->Axis(2) : src[0]->Axis(3);
+            _src8u = src[0]->GetType() == TensorType8u;
+            _dst8u = dst[0]->GetType() == TensorType8u;
+            assert(_src8u == _dst8u);
 
             size_t srcH = _srcH - _padY - _padH;
             size_t srcW = _srcW - _padX - _padW;
@@ -213,28 +196,48 @@ namespace Synet
             }
             else
                 assert(0);
-            if(_trans)
-                dst[0]->Reshape({ _num, _dstH, _dstW, _channels }, TensorFormatNhwc);
+            Shape dstShape = _trans ? Shp(_num, _dstH, _dstW, _channels) : Shp(_num, _channels, _dstH, _dstW);
+            if (_src8u && _dst8u)
+                dst[0]->As8u().Reshape(dstShape, src[0]->Format());
+            else
+                dst[0]->As32f().Reshape(dstShape, src[0]->Format());
+            if (srcH != _dstH || srcW != _dstW)
+                _resizer.Init(_src8u ? TensorType8u : TensorType32f, _trans ? _channels : 1, srcW, srcH, _dstW, _dstH, _alignCorners);
             else
-                dst[0]->Reshape({ _num, _channels, _dstH, _dstW }, TensorFormatNchw);
+                _resizer.Release();
             this->UsePerfStat();
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            const Type * pSrc = src[0]->CpuData();
-            Type * pDst = dst[0]->CpuData();
+            if (_src8u && _dst8u)
+                ForwardCpu(src[0]->As8u().CpuData(), dst[0]->As8u().CpuData());
+            else
+                ForwardCpu(src[0]->As32f().CpuData(), dst[0]->As32f().CpuData());
+        }
+
+        template<class TT> void ForwardCpu(const TT * src, TT * dst)
+        {
+            if (_resizer.Enable())
+            {
+                size_t channels = _trans ? _channels : 1, count = _trans ? _num : _num * _channels;
+                src += (_padY * _srcW + _padX) * channels;
+                _resizer.Forward(src, _srcW * channels, _srcH * _srcW * channels, dst, _dstW * channels, _dstH * _dstW * channels, count);
+                return;
+            }
             for(size_t i = 0; i < _num; ++i)
             {
-                Detail::Interp2LayerForwardCpu(_channels, pSrc, _srcH, _srcW, _padY, _padX, _padH, _padW, pDst, _dstH, _dstW, _alignCorners, _trans);
-                pSrc += _channels*_srcH*_srcW;
-                pDst += _channels*_dstH*_dstW;
+                Detail::Interp2LayerForwardCpu(_channels, src, _srcH, _srcW, _padY, _padX, _padH, _padW, dst, _dstH, _dstW, _alignCorners, _trans);
+                src += _channels*_srcH*_srcW;
+                dst += _channels*_dstH*_dstW;
             }
         }
 
     private:
         size_t _num, _channels, _srcH, _srcW, _dstH, _dstW, _padY, _padX, _padH, _padW;
         int _trans, _alignCorners;
+        bool _src8u, _dst8u;
+        InterpResizer _resizer;
     };
 }
\ No newline at end of file
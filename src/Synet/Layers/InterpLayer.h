@@ -50,40 +50,45 @@ namespace Synet
             }
         }
 
+        template <typename T> SYNET_INLINE T InterpCast(float value)
+        {
+            return T(value);
+        }
+
+        template <> SYNET_INLINE uint8_t InterpCast<uint8_t>(float value)
+        {
+            return (uint8_t)Round(value);
+        }
+
         template <typename T> void InterpLayerForwardCpuBilinear(size_t channels, const T * src, size_t srcH, size_t srcW, size_t sizeH, size_t sizeW, T * dst, size_t dstH, size_t dstW, int trans)
         {
-            if (trans)
-            {
-                assert(0);
-            }
-            else
+            const float rheight = (dstH > 1) ? static_cast<float>(sizeH - 1) / (dstH - 1) : 0.f;
+            const float rwidth = (dstW > 1) ? static_cast<float>(sizeW - 1) / (dstW - 1) : 0.f;
+            size_t cStep = trans ? 1 : srcH * srcW, dcStep = trans ? 1 : dstH * dstW, pStep = trans ? channels : 1;
+            for (int h2 = 0; h2 < dstH; ++h2)
             {
-                const float rheight = (dstH > 1) ? static_cast<float>(sizeH - 1) / (dstH - 1) : 0.f;
-                const float rwidth = (dstW > 1) ? static_cast<float>(sizeW - 1) / (dstW - 1) : 0.f;
-                for (int h2 = 0; h2 < dstH; ++h2)
+                const float h1r = rheight * h2;
+                const int h1 = (int)h1r;
+                const int h1p = (h1 < sizeH - 1) ? 1 : 0;
+                const float h1lambda = h1r - h1;
+                const float h0lambda = 1.0f - h1lambda;
+                for (int w2 = 0; w2 < dstW; ++w2)
                 {
-                    const float h1r = rheight * h2;
-                    const int h1 = (int)h1r;
-                    const int h1p = (h1 < sizeH - 1) ? 1 : 0;
-                    const T h1lambda = T(h1r - h1);
-                    const T h0lambda = T(1.) - h1lambda;
-                    for (int w2 = 0; w2 < dstW; ++w2)
+                    const float w1r = rwidth * w2;
+                    const int w1 = (int)w1r;
+                    const int w1p = (w1 < sizeW - 1) ? (int)pStep : 0;
+                    const float w1lambda = w1r - w1;
+                    const float w0lambda = 1.0f - w1lambda;
+                    const T * pos1 = &src[(h1 * srcW + w1) * pStep];
+                    T * pos2 = &dst[(h2 * dstW + w2) * pStep];
+                    size_t h1s = h1p * srcW * pStep;
+                    for (int c = 0; c < channels; ++c)
                     {
-                        const float w1r = rwidth * w2;
-                        const int w1 = (int)w1r;
-                        const int w1p = (w1 < sizeW - 1) ? 1 : 0;
-                        const T w1lambda = T(w1r - w1);
-                        const T w0lambda = T(1.) - w1lambda;
-                        const T * pos1 = &src[h1 * srcW + w1];
-                        T * pos2 = &dst[h2 * dstW + w2];
-                        for (int c = 0; c < channels; ++c)
-                        {
-                            pos2[0] =
-                                h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p]) +
-                                h1lambda * (w0lambda * pos1[h1p * srcW] + w1lambda * pos1[h1p * srcW + w1p]);
-                            pos1 += srcH * srcH;
-                            pos2 += dstH * dstW;
-                        }
+                        pos2[0] = InterpCast<T>(
+                            h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p]) +
+                            h1lambda * (w0lambda * pos1[h1s] + w1lambda * pos1[h1s + w1p]));
+                        pos1 += cStep;
+                        pos2 += dcStep;
                     }
                 }
             }
@@ -132,29 +137,6 @@ namespace Synet
             }
         }
 
-#if defined(SYNET_SIMD_LIBRARY_ENABLE)
-        template <> inline void InterpLayerForwardCpuBilinear<float>(size_t channels, const float * src, size_t srcH, size_t srcW, size_t sizeH, size_t sizeW, float * dst, size_t dstH, size_t dstW, int trans)
-        {
-            if (trans)
-            {
-                void * resizer = ::SimdResizerInit(sizeW, sizeH, dstW, dstH, channels, ::SimdResizeChannelFloat, ::SimdResizeMethodCaffeInterp);
-                ::SimdResizerRun(resizer, (uint8_t*)src, channels * srcW * sizeof(float), (uint8_t*)dst, channels * dstW * sizeof(float));
-                ::SimdRelease(resizer);
-            }
-            else
-            {
-                void * resizer = ::SimdResizerInit(sizeW, sizeH, dstW, dstH, 1, ::SimdResizeChannelFloat, ::SimdResizeMethodCaffeInterp);
-                for (size_t c = 0; c < channels; ++c)
-                {
-                    ::SimdResizerRun(resizer, (uint8_t*)src, srcW * sizeof(float), (uint8_t*)dst, dstW * sizeof(float));
-                    src += srcH * srcW;
-                    dst += dstH * dstW;
-                }
-                ::SimdRelease(resizer);            
-            }
-        }
-#endif
-
         template <typename T> void InterpLayerForwardCpu(size_t channels, const T * src, size_t srcH, size_t srcW, size_t cropB, size_t cropE, T * dst, size_t dstH, size_t dstW, InterpolationType type, int trans)
         {
             size_t sizeH = srcH - cropB - cropE;
@@ -171,6 +153,72 @@ namespace Synet
         }
     }
 
+    class InterpResizer
+    {
+    public:
+        InterpResizer()
+            : _context(NULL)
+            , _type(TensorTypeUnknown)
+            , _channels(0)
+            , _srcW(0)
+            , _srcH(0)
+            , _dstW(0)
+            , _dstH(0)
+            , _alignCorners(-1)
+        {
+        }
+
+        virtual ~InterpResizer()
+        {
+            Release();
+        }
+
+        SYNET_INLINE void Init(TensorType type, size_t channels, size_t srcW, size_t srcH, size_t dstW, size_t dstH, int alignCorners)
+        {
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+            if (_type == type && _channels == channels && _srcW == srcW && _srcH == srcH && _dstW == dstW && _dstH == dstH && _alignCorners == alignCorners)
+                return;
+            Release();
+            _type = type, _channels = channels, _srcW = srcW, _srcH = srcH, _dstW = dstW, _dstH = dstH, _alignCorners = alignCorners;
+            if (type != TensorType32f && type != TensorType8u)
+                return;
+            ::SimdResizeChannelType channel = type == TensorType8u ? ::SimdResizeChannelByte : ::SimdResizeChannelFloat;
+            ::SimdResizeMethodType method = alignCorners ? ::SimdResizeMethodCaffeInterp : ::SimdResizeMethodInferenceEngineInterp;
+            _context = ::SimdResizerInit(srcW, srcH, dstW, dstH, channels, channel, method);
+#endif
+        }
+
+        SYNET_INLINE void Release()
+        {
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+            if (_context)
+                ::SimdRelease(_context), _context = NULL;
+#endif
+            _type = TensorTypeUnknown;
+        }
+
+        SYNET_INLINE bool Enable() const
+        {
+            return _context != NULL;
+        }
+
+        template<class T> SYNET_INLINE void Forward(const T * src, size_t srcStride, size_t srcStep, T * dst, size_t dstStride, size_t dstStep, size_t count)
+        {
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+            for (size_t i = 0; i < count; ++i, src += srcStep, dst += dstStep)
+                ::SimdResizerRun(_context, (const uint8_t*)src, srcStride * sizeof(T), (uint8_t*)dst, dstStride * sizeof(T));
+#endif
+        }
+
+    private:
+        void * _context;
+        TensorType _type;
+        size_t _channels, _srcW, _srcH, _dstW, _dstH;
+        int _alignCorners;
+    };
+
+    //-------------------------------------------------------------------------
+
     template <class T> class InterpLayer : public Synet::Layer<T>
     {
     public:
@@ -191,8 +239,7 @@ namespace Synet
 
         virtual bool Can8i() const
         {
-            const InterpParam& param = this->Param().interp();
-            return param.interpolationType() == InterpolationTypeNearest;
+            return true;
         }
 
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
@@ -247,12 +294,13 @@ namespace Synet
                 assert(0);
             Shape dstShape = _trans ? Shp(_num, _dstH, _dstW, _channels) : Shp(_num, _channels, _dstH, _dstW);
             if (_src8u && _dst8u)
-            {
-                assert(param.interpolationType() == InterpolationTypeNearest);
                 dst[0]->As8u().Reshape(dstShape, src[0]->Format());
-            }
             else
                 dst[0]->As32f().Reshape(dstShape, src[0]->Format());
+            if (_type == InterpolationTypeBilinear && (srcH != _dstH || srcW != _dstW))
+                _resizer.Init(_src8u ? TensorType8u : TensorType32f, _trans ? _channels : 1, srcW, srcH, _dstW, _dstH, 1);
+            else
+                _resizer.Release();
             this->UsePerfStat();
         }
 
@@ -267,6 +315,13 @@ namespace Synet
 
         template<class TT> void ForwardCpu(const TT * src, TT * dst)
         {
+            if (_resizer.Enable())
+            {
+                size_t channels = _trans ? _channels : 1, count = _trans ? _num : _num * _channels;
+                src += (_cropBeg * _srcW + _cropBeg) * channels;
+                _resizer.Forward(src, _srcW * channels, _srcH * _srcW * channels, dst, _dstW * channels, _dstH * _dstW * channels, count);
+                return;
+            }
             for (size_t i = 0; i < _num; ++i)
             {
                 Detail::InterpLayerForwardCpu(_channels, src, _srcH, _srcW, _cropBeg, _cropEnd, dst, _dstH, _dstW, _type, _trans);
@@ -280,5 +335,6 @@ namespace Synet
         InterpolationType _type;
         int _trans;
         bool _src8u, _dst8u;
+        InterpResizer _resizer;
     };
 }
\ No newline at end of file
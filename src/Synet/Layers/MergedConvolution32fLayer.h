@@ -117,6 +117,12 @@ namespace Synet
             return Base::MemoryUsage() + _mergedConvolution32f.InternalBufferSize() * sizeof(Type);
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _mergedConvolution32f.Share(((const MergedConvolution32fLayer&)layer)._mergedConvolution32f);
+        }
+
     protected:
         typedef typename MergedConvolutionLayer<T>::AlgParam AlgParam;
 
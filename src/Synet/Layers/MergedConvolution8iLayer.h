@@ -68,6 +68,12 @@ namespace Synet
                 + _weight8i[1].MemoryUsage() + _norm32f[1].MemoryUsage() + _bias32f[1].MemoryUsage();
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _mergedConvolution8i.Share(((const MergedConvolution8iLayer&)layer)._mergedConvolution8i);
+        }
+
         virtual void DebugPrint(std::ostream& os, int flag, int first, int last, int precision)
         {
             Synet::DebugPrint(os, _srcCvt.scale, _srcCvt.channels, "_srcCvt.scale", first, last, precision);
@@ -32,6 +32,37 @@ namespace Synet
 {
     namespace Detail
     {
+        template <class T, size_t N> SYNET_INLINE void PermuteTile(const T * src, size_t srcStride, T * dst, size_t dstStride)
+        {
+            for (size_t c = 0; c < N; ++c)
+                for (size_t r = 0; r < N; ++r)
+                    dst[c * dstStride + r] = src[r * srcStride + c];
+        }
+
+        template <class T> void PermuteTranspose(const T * src, size_t srcStride, size_t rows, size_t cols, T * dst, size_t dstStride)
+        {
+            const size_t N = sizeof(T) == 1 ? 16 : 8, B = 64;
+            for (size_t rb = 0; rb < rows; rb += B)
+            {
+                size_t re = std::min(rb + B, rows);
+                for (size_t cb = 0; cb < cols; cb += B)
+                {
+                    size_t ce = std::min(cb + B, cols), r = rb;
+                    for (; r + N <= re; r += N)
+                    {
+                        size_t c = cb;
+                        for (; c + N <= ce; c += N)
+                            PermuteTile<T, N>(src + r * srcStride + c, srcStride, dst + c * dstStride + r, dstStride);
+                        for (; c < ce; ++c)
+                            for (size_t i = 0; i < N; ++i)
+                                dst[c * dstStride + r + i] = src[(r + i) * srcStride + c];
+                    }
+                    for (; r < re; ++r)
+                        for (size_t c = cb; c < ce; ++c)
+                            dst[c * dstStride + r] = src[r * srcStride + c];
+                }
+            }
+        }
     }
 
     template <class T> class PermuteLayer : public Synet::Layer<T>
@@ -46,52 +77,99 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const PermuteParam & param = this->Param().permute();
-            _permute = false;
-            _order = param.order();
-            _count = _order.size();
-            assert(_count >= 2 && _count <= 5);
+            const Shape & order = param.order();
+            const Shape & srcShape = src[0]->Shape();
+            size_t count = order.size();
+            assert(count >= 2 && count == srcShape.size());
             size_t is = 0, os = 0;
-            Shape permute;
-            for (size_t i = 0; i < _order.size(); ++i)
+            for (size_t i = 0; i < count; ++i)
             {
-                if (_order[i] != i)
-                    permute.push_back(i);
                 is += i;
-                os += _order[i];
+                os += order[i];
             }
             assert(is == os);
-            _permute = permute.size() > 1;
-            if (permute.size() == 2 && permute[0] + 1 == permute[1])
+
+            Shape dstShape(count), index(count, size_t(-1));
+            for (size_t i = 0; i < count; ++i)
+                dstShape[i] = srcShape[order[i]];
+            Shape kept;
+            for (size_t i = 0; i < count; ++i)
+                if (srcShape[order[i]] > 1)
+                    kept.push_back(order[i]);
+            _perm.clear();
+            for (size_t i = 0; i < kept.size(); ++i)
+            {
+                if (_perm.empty() || kept[i] != kept[i - 1] + 1)
+                    _perm.push_back(kept[i]);
+            }
+            Shape sorted = _perm;
+            std::sort(sorted.begin(), sorted.end());
+            _shape.assign(sorted.size(), 1);
+            for (size_t i = 0; i < sorted.size(); ++i)
             {
-                if (src[0]->Axis(permute[0]) == 1 || src[0]->Axis(permute[1]) == 1)
-                    _permute = false;
+                size_t end = i + 1 < sorted.size() ? sorted[i + 1] : count;
+                for (size_t a = sorted[i]; a < end; ++a)
+                    _shape[i] *= srcShape[a];
+                index[sorted[i]] = i;
             }
+            for (size_t i = 0; i < _perm.size(); ++i)
+                _perm[i] = index[_perm[i]];
+            _permute = false;
+            for (size_t i = 0; i < _perm.size(); ++i)
+                _permute = _permute || _perm[i] != i;
 
-            _srcShape = src[0]->Shape();
-            assert(_srcShape.size() == _count);
-            _dstShape.clear();
-            for (size_t i = 0; i < _count; ++i)
-                _dstShape.push_back(_srcShape[_order[i]]);
+            TensorFormat format = param.format() == TensorFormatUnknown ? src[0]->Format() : param.format();
             if (_permute)
             {
-                _srcStride.resize(_count, 1);
-                _dstStride.resize(_count, 1);
-                Shape dstStride(_count, 1);
-                for (ptrdiff_t i = _count - 2; i >= 0; i--)
+                size_t n = _shape.size();
+                Shape srcStride(n, 1), dstStride(n, 1), dstStrideBySrc(n);
+                for (ptrdiff_t i = n - 2; i >= 0; i--)
+                {
+                    srcStride[i] = srcStride[i + 1] * _shape[i + 1];
+                    dstStride[i] = dstStride[i + 1] * _shape[_perm[i + 1]];
+                }
+                for (size_t i = 0; i < n; ++i)
+                    dstStrideBySrc[_perm[i]] = dstStride[i];
+                _inner = _perm[n - 1];
+                _rows = _shape[_inner];
+                _cols = _shape[n - 1];
+                _srcRowStride = srcStride[_inner];
+                _dstRowStride = dstStrideBySrc[n - 1];
+                _outerShape.clear();
+                _outerSrcStride.clear();
+                _outerDstStride.clear();
+                for (size_t i = 0; i < n; ++i)
                 {
-                    _srcStride[i] = _srcStride[i + 1] * _srcShape[i + 1];
-                    dstStride[i] = dstStride[i + 1] * _dstShape[i + 1];
+                    size_t a = _perm[i];
+                    if (a == _inner || a == n - 1)
+                        continue;
+                    _outerShape.push_back(_shape[a]);
+                    _outerSrcStride.push_back(srcStride[a]);
+                    _outerDstStride.push_back(dstStrideBySrc[a]);
+                }
+                _type = src[0]->GetType();
+                switch (_type)
+                {
+                case TensorType32f: dst[0]->As32f().Reshape(dstShape, format); break;
+                case TensorType32i: dst[0]->As32i().Reshape(dstShape, format); break;
+                case TensorType8i: dst[0]->As8i().Reshape(dstShape, format); break;
+                case TensorType8u: dst[0]->As8u().Reshape(dstShape, format); break;
+                case TensorType64i: dst[0]->As64i().Reshape(dstShape, format); break;
+                default:
+                    assert(0);
                 }
-                for (size_t i = 0; i < _count; ++i)
-                    _dstStride[_order[i]] = dstStride[i];
-                dst[0]->Reshape(_dstShape, param.format() == TensorFormatUnknown ? src[0]->Format() : param.format());
                 this->UsePerfStat();
             }
             else
-                dst[0]->ShareAs(*src[0], _dstShape, param.format() == TensorFormatUnknown ? src[0]->Format() : param.format());
+                dst[0]->ShareAs(*src[0], dstShape, format);
         }
 
     protected:
@@ -99,81 +177,50 @@ namespace Synet
         {
             if (_permute)
             {
-                const Type * pSrc = src[0]->CpuData();
-                Type * pDst = dst[0]->CpuData();
-                switch (_count)
+                const uint8_t * pSrc = src[0]->RawCpuData();
+                uint8_t * pDst = dst[0]->RawCpuData();
+                switch (Detail::TensorTypeSize(_type))
                 {
-                case 2:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
-                    {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            size_t srcOffset = i*_srcStride[0] + j*_srcStride[1];
-                            size_t dstOffset = i*_dstStride[0] + j*_dstStride[1];
-                            pDst[dstOffset] = pSrc[srcOffset];
-                        }
-                    }
-                    break;
-                case 3:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
-                    {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            for (size_t k = 0; k < _srcShape[2]; ++k)
-                            {
-                                size_t srcOffset = i*_srcStride[0] + j*_srcStride[1] + k*_srcStride[2];
-                                size_t dstOffset = i*_dstStride[0] + j*_dstStride[1] + k*_dstStride[2];
-                                pDst[dstOffset] = pSrc[srcOffset];
-                            }
-                        }
-                    }
-                    break;
-                case 4:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
-                    {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            for (size_t k = 0; k < _srcShape[2]; ++k)
-                            {
-                                for (size_t l = 0; l < _srcShape[3]; ++l)
-                                {
-                                    size_t srcOffset = i*_srcStride[0] + j*_srcStride[1] + k*_srcStride[2] + l*_srcStride[3];
-                                    size_t dstOffset = i*_dstStride[0] + j*_dstStride[1] + k*_dstStride[2] + l*_dstStride[3];
-                                    pDst[dstOffset] = pSrc[srcOffset];
-                                }
-                            }
-                        }
-                    }
-                    break;
-                case 5:
-                    for (size_t i = 0; i < _srcShape[0]; ++i)
-                    {
-                        for (size_t j = 0; j < _srcShape[1]; ++j)
-                        {
-                            for (size_t k = 0; k < _srcShape[2]; ++k)
-                            {
-                                for (size_t l = 0; l < _srcShape[3]; ++l)
-                                {
-                                    for (size_t m = 0; m < _srcShape[4]; ++m)
-                                    {
-                                        size_t srcOffset = i*_srcStride[0] + j*_srcStride[1] + k*_srcStride[2] + l*_srcStride[3] + m*_srcStride[4];
-                                        size_t dstOffset = i*_dstStride[0] + j*_dstStride[1] + k*_dstStride[2] + l*_dstStride[3] + m*_dstStride[4];
-                                        pDst[dstOffset] = pSrc[srcOffset];
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    break;
+                case 1: Permute((const uint8_t*)pSrc, (uint8_t*)pDst); break;
+                case 4: Permute((const uint32_t*)pSrc, (uint32_t*)pDst); break;
+                case 8: Permute((const uint64_t*)pSrc, (uint64_t*)pDst); break;
                 default:
                     assert(0);
                 }
             }
         }
 
+        template <class TT> void Permute(const TT * src, TT * dst)
+        {
+            size_t outer = _outerShape.size();
+            Shape index(outer, 0);
+            size_t srcOffset = 0, dstOffset = 0;
+            while (true)
+            {
+                if (_inner == _shape.size() - 1)
+                    memcpy(dst + dstOffset, src + srcOffset, _cols * sizeof(TT));
+                else
+                    Detail::PermuteTranspose(src + srcOffset, _srcRowStride, _rows, _cols, dst + dstOffset, _dstRowStride);
+                ptrdiff_t i = outer - 1;
+                for (; i >= 0; --i)
+                {
+                    srcOffset += _outerSrcStride[i];
+                    dstOffset += _outerDstStride[i];
+                    if (++index[i] < _outerShape[i])
+                        break;
+                    srcOffset -= _outerSrcStride[i] * _outerShape[i];
+                    dstOffset -= _outerDstStride[i] * _outerShape[i];
+                    index[i] = 0;
+                }
+                if (i < 0)
+                    break;
+            }
+        }
+
     private:
         bool _permute;
-        size_t _count;
-        Shape _order, _srcShape, _dstShape, _srcStride, _dstStride;
+        TensorType _type;
+        size_t _inner, _rows, _cols, _srcRowStride, _dstRowStride;
+        Shape _shape, _perm, _outerShape, _outerSrcStride, _outerDstStride;
     };
-}
\ No newline at end of file
+}
@@ -80,14 +80,14 @@ namespace Synet
             this->UsePerfStat();
         }
 
-        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst)
+        void GetRegions(const TensorPtrs & src, Type threshold, Regions & dst, size_t batch = 0)
         {
             SYNET_PERF_FUNC();
             dst.clear();
-            const Type * pPredict = src[0]->CpuData();
             size_t height = src[0]->Axis(2);
             size_t width = src[0]->Axis(3);
             size_t outputs = src[0]->Size(1);
+            const Type * pPredict = src[0]->CpuData() + batch * outputs;
             for (size_t i = 0; i < width*height; ++i) 
             {
                 size_t row = i / height;
@@ -99,18 +99,25 @@ namespace Synet
                     Type scale = pPredict[predictIndex];
                     if (_classfix == -1 && scale < Type(0.5)) 
                         scale = Type(0);
+                    if (_softmax && scale <= threshold)
+                        continue;
                     size_t regionIndex = index * (_classes + 5);
                     Region r;
-                    r.x = (col + CpuSigmoid(pPredict[regionIndex + 0])) / width;
-                    r.y = (row + CpuSigmoid(pPredict[regionIndex + 1])) / height;
-                    r.w = ::exp(pPredict[regionIndex + 2]) * _anchors[2 * n] / width;
-                    r.h = ::exp(pPredict[regionIndex + 3]) * _anchors[2 * n + 1] / height;
+                    bool decoded = false;
                     size_t classIndex = index * (_classes + 5) + 5;
                     for (size_t id = 0; id < _classes; ++id)
                     {
                         Type prob = scale*pPredict[classIndex + id];
                         if (prob > threshold)
                         {
+                            if (!decoded)
+                            {
+                                r.x = (col + CpuSigmoid(pPredict[regionIndex + 0])) / width;
+                                r.y = (row + CpuSigmoid(pPredict[regionIndex + 1])) / height;
+                                r.w = ::exp(pPredict[regionIndex + 2]) * _anchors[2 * n] / width;
+                                r.h = ::exp(pPredict[regionIndex + 3]) * _anchors[2 * n + 1] / height;
+                                decoded = true;
+                            }
                             r.prob = prob;
                             r.id = id;
                             dst.push_back(r);
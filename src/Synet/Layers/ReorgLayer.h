@@ -97,6 +97,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const ReorgParam & param = this->Param().reorg();
@@ -135,22 +140,34 @@ namespace Synet
                     shape[3] = shape[3] / _stride;
                 }
             }
-            dst[0]->Reshape(shape, src[0]->Format());
+            _src8u = src[0]->GetType() == TensorType8u;
+            if (_src8u)
+                dst[0]->As8u().Reshape(shape, src[0]->Format());
+            else
+                dst[0]->As32f().Reshape(shape, src[0]->Format());
             this->UsePerfStat();
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            const Shape & shape = dst[0]->Shape();
+            if (_src8u)
+                ForwardCpu(src[0]->As8u().CpuData(), dst[0]->Shape(), dst[0]->As8u().CpuData());
+            else
+                ForwardCpu(src[0]->As32f().CpuData(), dst[0]->Shape(), dst[0]->As32f().CpuData());
+        }
+
+        template<class TT> void ForwardCpu(const TT * src, const Shape & shape, TT * dst)
+        {
             if(_trans)
-                Detail::ReorgLayerForwardCpu(src[0]->CpuData(), shape[0], shape[3], shape[1], shape[2], _stride, _reverse, _trans, dst[0]->CpuData());
+                Detail::ReorgLayerForwardCpu(src, shape[0], shape[3], shape[1], shape[2], _stride, _reverse, _trans, dst);
             else
-                Detail::ReorgLayerForwardCpu(src[0]->CpuData(), shape[0], shape[1], shape[2], shape[3], _stride, _reverse, _trans, dst[0]->CpuData());
+                Detail::ReorgLayerForwardCpu(src, shape[0], shape[1], shape[2], shape[3], _stride, _reverse, _trans, dst);
         }
 
     private:
         size_t _stride;
         int _reverse, _trans;
+        bool _src8u;
     };
 }
\ No newline at end of file
@@ -26,6 +26,8 @@
 
 #include "Synet/Common.h"
 #include "Synet/Layer.h"
+#include "Synet/Utils/Activation.h"
+#include "Synet/Utils/Gemm.h"
 #include "Synet/Utils/InnerProduct.h"
 #include "Synet/Layers/UnaryOperationLayer.h"
 
@@ -33,7 +35,21 @@ namespace Synet
 {
     namespace Detail
     {
+        SYNET_INLINE void RnnGruBdGateReset(const float* reset, const float* hidden, size_t size, float* dst)
+        {
+            for (size_t i = 0; i < size; ++i)
+                dst[i] = reset[i] * hidden[i];
+        }
 
+        SYNET_INLINE void RnnGruBdGateUpdate(const float* candidate, const float* update, const float* hidden, size_t size, float* dst0, float* dst1)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                float value = candidate[i] + update[i] * (hidden[i] - candidate[i]);
+                dst0[i] = value;
+                dst1[i] = value;
+            }
+        }
     }
 
     template <class T> class RnnGruBdLayer : public Synet::Layer<T>
@@ -68,7 +84,6 @@ namespace Synet
 
             _innerProduct32f[0].Init(_batch, _input + _output, 2 * _output, 1);
             _innerProduct32f[1].Init(_batch, _input + _output, _output, 1);
-            assert(_innerProduct32f[0].Enable() && _innerProduct32f[1].Enable());
             _innerProduct32f[0].SetParams(weight[0].CpuData(), &_internal[0], weight[1].CpuData(), NULL);
             _innerProduct32f[1].SetParams(weight[2].CpuData(), &_internal[1], weight[3].CpuData(), NULL);
 
@@ -95,6 +110,13 @@ namespace Synet
                 _innerProduct32f[0].InternalBufferSize() + _innerProduct32f[1].InternalBufferSize()) * sizeof(float);
         }
 
+        virtual void Share(const Base & layer)
+        {
+            Base::Share(layer);
+            _innerProduct32f[0].Share(((const RnnGruBdLayer&)layer)._innerProduct32f[0]);
+            _innerProduct32f[1].Share(((const RnnGruBdLayer&)layer)._innerProduct32f[1]);
+        }
+
         virtual void CompactWeight()
         {
             if (_internal[0])
@@ -116,28 +138,42 @@ namespace Synet
             float* buf11 = buf10 + _output;
             float* buf2 = _buffer[2].CpuData();
 
-            if (_batch == 1)
-            {
-                memcpy(buf00, src0, _input * sizeof(float));
-                memcpy(buf01, src1, _output * sizeof(float));
+            size_t stride0 = _input + _output, stride1 = 2 * _output;
 
-                _innerProduct32f[0].Forward(buf00, buf10);
-                CpuSigmoid(buf10, _output * 2, buf10);
+            for (size_t b = 0; b < _batch; ++b)
+            {
+                memcpy(buf00 + b * stride0, src0 + b * _input, _input * sizeof(float));
+                memcpy(buf01 + b * stride0, src1 + b * _output, _output * sizeof(float));
+            }
 
-                for (size_t i = 0; i < _output; ++i)
-                    buf01[i] = buf10[i]*src1[i];
+            InnerProduct(0, buf00, 2 * _output, buf10);
+            CpuSigmoid(buf10, _batch * stride1, buf10);
 
-                _innerProduct32f[1].Forward(buf00, buf2);
-                Detail::UnaryOperationLayerForward(buf2, _output, UnaryOperationTypeTanh, buf2);
+            for (size_t b = 0; b < _batch; ++b)
+                Detail::RnnGruBdGateReset(buf10 + b * stride1, src1 + b * _output, _output, buf01 + b * stride0);
 
-                for (size_t i = 0; i < _output; ++i)
-                    dst0[i] = (1.0f - buf11[i]) * buf2[i] + src1[i]* buf11[i];
+            InnerProduct(1, buf00, _output, buf2);
+            Detail::UnaryOperationLayerForward(buf2, _batch * _output, UnaryOperationTypeTanh, buf2);
 
-                for (size_t i = 0; i < _output; ++i)
-                    dst1[i] = dst0[i];
+            for (size_t b = 0; b < _batch; ++b)
+            {
+                size_t offs = b * _output;
+                Detail::RnnGruBdGateUpdate(buf2 + offs, buf11 + b * stride1, src1 + offs, _output, dst0 + offs, dst1 + offs);
             }
+        }
+
+        void InnerProduct(size_t index, const float* src, size_t output, float* dst)
+        {
+            if (_innerProduct32f[index].Enable())
+                _innerProduct32f[index].Forward(src, dst);
             else
-                assert(0);
+            {
+                const Tensors& weight = this->Weight();
+                size_t input = _input + _output;
+                CpuGemm(CblasNoTrans, CblasTrans, _batch, output, input, 1.0f, src, input, weight[index * 2 + 0].CpuData(), input, 0.0f, dst, output);
+                for (size_t b = 0; b < _batch; ++b)
+                    CpuAddBias(weight[index * 2 + 1].CpuData(), output, 1, dst + b * output);
+            }
         }
 
         int _internal[2];
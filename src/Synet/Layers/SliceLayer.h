@@ -42,11 +42,17 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const SliceParam & param = this->Param().slice();
             _sliceAxis = param.axis();            
             _slicePoint = param.slicePoint();
+            _src8u = src[0]->GetType() == TensorType8u;
             Shape dstShape = src[0]->Shape();
             size_t srcSliceAxis = src[0]->Axis(_sliceAxis);
             _numSlices = src[0]->Size(0, _sliceAxis);
@@ -68,7 +74,7 @@ namespace Synet
                 for (size_t i = 0; i < dst.size(); ++i)
                 {
                     dstShape[_sliceAxis] = slices[i];
-                    dst[i]->Reshape(dstShape);
+                    ReshapeDst(*dst[i], dstShape);
                     size += dst[i]->Size();
                 }
             }
@@ -78,7 +84,7 @@ namespace Synet
                 dstShape[_sliceAxis] = srcSliceAxis / dst.size();
                 for (int i = 0; i < dst.size(); ++i) 
                 {
-                    dst[i]->Reshape(dstShape);
+                    ReshapeDst(*dst[i], dstShape);
                     size += dst[i]->Size();
                 }
             }
@@ -93,12 +99,28 @@ namespace Synet
         {
             if (dst.size() == 1) 
                 return;
+            if (_src8u)
+                ForwardCpu<uint8_t>(src, dst);
+            else
+                ForwardCpu<float>(src, dst);
+        }
+
+        void ReshapeDst(typename Base::Tensor & dst, const Shape & shape)
+        {
+            if (_src8u)
+                dst.As8u().Reshape(shape);
+            else
+                dst.As32f().Reshape(shape);
+        }
+
+        template<class TT> void ForwardCpu(const TensorPtrs & src, const TensorPtrs & dst)
+        {
             size_t offsetSliceAxis = 0;
-            const Type * pSrc = src[0]->CpuData();
+            const TT * pSrc = (const TT*)src[0]->RawCpuData();
             size_t srcSliceAxis = src[0]->Axis(_sliceAxis);
             for (size_t i = 0; i < dst.size(); ++i)
             {
-                Type * pDst = dst[i]->CpuData();
+                TT * pDst = (TT*)dst[i]->RawCpuData();
                 size_t dstSliceAxis = dst[i]->Axis(_sliceAxis);
                 for (int n = 0; n < _numSlices; ++n)
                 {
@@ -112,6 +134,7 @@ namespace Synet
 
     private:
         size_t _numSlices, _sliceSize, _sliceAxis;
+        bool _src8u;
         Index _slicePoint;
     };
 }
\ No newline at end of file
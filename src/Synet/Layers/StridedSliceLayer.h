@@ -42,6 +42,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const StridedSliceParam & param = this->Param().stridedSlice();
@@ -85,7 +90,11 @@ namespace Synet
                     assert(0);
                 _dstDims[i] = count;
             }
-            dst[0]->Reshape(_dstDims, src[0]->Format());
+            _src8u = src[0]->GetType() == TensorType8u;
+            if (_src8u)
+                dst[0]->As8u().Reshape(_dstDims, src[0]->Format());
+            else
+                dst[0]->As32f().Reshape(_dstDims, src[0]->Format());
 
             _srcStrides.resize(_srcDims.size(), 1);
             for (size_t i = 0; i < _srcDims.size(); ++i)
@@ -99,8 +108,14 @@ namespace Synet
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            const Type * pSrc0 = src[0]->CpuData();
-            Type * pDst0 = dst[0]->CpuData();
+            if (_src8u)
+                ForwardCpu(src[0]->As8u().CpuData(), dst[0]->As8u().CpuData());
+            else
+                ForwardCpu(src[0]->As32f().CpuData(), dst[0]->As32f().CpuData());
+        }
+
+        template<class TT> void ForwardCpu(const TT * pSrc0, TT * pDst0)
+        {
             switch (_srcDims.size())
             {
             case 1:
@@ -110,8 +125,8 @@ namespace Synet
             case 2:
                 for (size_t s0 = _beginDims[0], d0 = 0; d0 < _dstDims[0]; d0 += 1, s0 += _strideDims[0])
                 {
-                    const Type * pSrc1 = pSrc0 + s0 * _srcStrides[1];
-                    Type * pDst1 = pDst0 + d0 * _dstStrides[1];
+                    const TT * pSrc1 = pSrc0 + s0 * _srcStrides[1];
+                    TT * pDst1 = pDst0 + d0 * _dstStrides[1];
                     for (size_t s1 = _beginDims[1], d1 = 0; d1 < _dstDims[1]; d1 += 1, s1 += _strideDims[1])
                         pDst1[d1] = pSrc1[s1];
                 }
@@ -119,12 +134,12 @@ namespace Synet
             case 3:
                 for (size_t s0 = _beginDims[0], d0 = 0; d0 < _dstDims[0]; d0 += 1, s0 += _strideDims[0])
                 {
-                    const Type * pSrc1 = pSrc0 + s0 * _srcStrides[1];
-                    Type * pDst1 = pDst0 + d0 * _dstStrides[1];
+                    const TT * pSrc1 = pSrc0 + s0 * _srcStrides[1];
+                    TT * pDst1 = pDst0 + d0 * _dstStrides[1];
                     for (size_t s1 = _beginDims[1], d1 = 0; d1 < _dstDims[1]; d1 += 1, s1 += _strideDims[1])
                     {
-                        const Type * pSrc2 = pSrc1 + s1 * _srcStrides[2];
-                        Type * pDst2 = pDst1 + d1 * _dstStrides[2];
+                        const TT * pSrc2 = pSrc1 + s1 * _srcStrides[2];
+                        TT * pDst2 = pDst1 + d1 * _dstStrides[2];
                         for (size_t s2 = _beginDims[2], d2 = 0; d2 < _dstDims[2]; d2 += 1, s2 += _strideDims[2])
                             pDst2[d2] = pSrc2[s2];
                     }
@@ -133,16 +148,16 @@ namespace Synet
             case 4:
                 for (size_t s0 = _beginDims[0], d0 = 0; d0 < _dstDims[0]; d0 += 1, s0 += _strideDims[0])
                 {
-                    const Type * pSrc1 = pSrc0 + s0 * _srcStrides[1];
-                    Type * pDst1 = pDst0 + d0 * _dstStrides[1];
+                    const TT * pSrc1 = pSrc0 + s0 * _srcStrides[1];
+                    TT * pDst1 = pDst0 + d0 * _dstStrides[1];
                     for (size_t s1 = _beginDims[1], d1 = 0; d1 < _dstDims[1]; d1 += 1, s1 += _strideDims[1])
                     {
-                        const Type * pSrc2 = pSrc1 + s1 * _srcStrides[2];
-                        Type * pDst2 = pDst1 + d1 * _dstStrides[2];
+                        const TT * pSrc2 = pSrc1 + s1 * _srcStrides[2];
+                        TT * pDst2 = pDst1 + d1 * _dstStrides[2];
                         for (size_t s2 = _beginDims[2], d2 = 0; d2 < _dstDims[2]; d2 += 1, s2 += _strideDims[2])
                         {
-                            const Type * pSrc3 = pSrc2 + s2 * _srcStrides[3];
-                            Type * pDst3 = pDst2 + d2 * _dstStrides[3];
+                            const TT * pSrc3 = pSrc2 + s2 * _srcStrides[3];
+                            TT * pDst3 = pDst2 + d2 * _dstStrides[3];
                             for (size_t s3 = _beginDims[3], d3 = 0; d3 < _dstDims[3]; d3 += 1, s3 += _strideDims[3])
                                 pDst3[d3] = pSrc3[s3];
                         }
@@ -157,5 +172,6 @@ namespace Synet
     private:
         Shape _beginDims, _endDims, _strideDims, _srcDims, _dstDims;
         Shape _srcStrides, _dstStrides;
+        bool _src8u;
     };
 }
\ No newline at end of file
@@ -30,6 +30,8 @@
 
 namespace Synet
 {
+    template <class T> class Fabric;
+
     template <class T> class TensorIteratorLayer : public Synet::Layer<T>
     {
     public:
@@ -46,6 +48,8 @@ namespace Synet
         TensorIteratorLayer(const LayerParam & param, Context* context)
             : Base(param, context)
             , _empty(true)
+            , _hoisting(false)
+            , _shareSrc(false)
         {
         }
 
@@ -55,6 +59,7 @@ namespace Synet
             {
                 InitGraph(buf);
                 SetLinks(src, dst);
+                InitHoisting();
                 _empty = false;
             }
 
@@ -69,10 +74,18 @@ namespace Synet
             _itCount = srcShape[_srcAxis];
             _srcInt = itSrc->Size(_srcAxis + 1);
             srcShape[_srcAxis] = 1;
+            if (_shareSrc)
+                _src[_itSrc.second]->Clear(true);
             _src[_itSrc.second]->Reshape(srcShape, itSrc->Format());
 
-            for (size_t i = 0; i < _stages.size(); ++i)
-                _stages[i].layer->Reshape(_stages[i].src, _stages[i].buf, _stages[i].dst);
+            _hoisting = _hoist.size() && _srcExt == 1;
+            if (_hoisting)
+            {
+                ReshapeHoisted(itSrc, srcShape);
+                _hoisting = ReshapeStages(true);
+            }
+            if (!_hoisting)
+                ReshapeStages(false);
 
             for (size_t b = 0; b < _bLink.size(); ++b)
             {
@@ -82,8 +95,8 @@ namespace Synet
             }
             for (size_t o = 0; o < _oLink.size(); ++o)
             {
-                const Tensor* oDst = src[_oLink[o].first];
-                src[_oLink[o].second]->Reshape(oDst->Shape(), oDst->Format());
+                const Tensor* oDst = _dst[_oLink[o].first];
+                dst[_oLink[o].second]->Reshape(oDst->Shape(), oDst->Format());
             }
             const Tensor* itDst = _dst[_itDst.first];
             Shape dstShape = itDst->Shape();
@@ -95,6 +108,8 @@ namespace Synet
 
             std::stringstream desc;
             desc << _srcExt << "x" << _itCount << "x" << _srcInt << "-" << _dstInt;
+            if (_hoisting)
+                desc << "-h" << _hoisted.size();
             this->UsePerfStat(desc.str(), Flop());
         }
 
@@ -124,6 +139,15 @@ namespace Synet
                     unique.insert(ptr);
                 }
             }
+            for (size_t i = _shareSrc ? 1 : 0; i < _batch.size(); ++i)
+            {
+                const void* ptr = _batch[i]->RawCpuData();
+                if (unique.find(ptr) == unique.end())
+                {
+                    memoryUsage += _batch[i]->MemoryUsage();
+                    unique.insert(ptr);
+                }
+            }
             return memoryUsage;
         }
 
@@ -138,16 +162,43 @@ namespace Synet
                 memcpy(pDst, pSrc, size * sizeof(T));
             }
             const T* pSrcE = src[_itSrc.first]->CpuData();
-            T* pSrcI = _src[_itSrc.second]->CpuData();
+            Tensor* itSrc = _src[_itSrc.second];
             const T* pDstI = _dst[_itDst.first]->CpuData();
             T* pDstE = dst[_itDst.second]->CpuData();
+            if (_hoisting)
+            {
+                Tensor& batch = *_batch[0];
+                if (_shareSrc)
+                    batch.ShareAs(pSrcE, batch.Size(), batch.Shape(), batch.Format());
+                else
+                    memcpy(batch.CpuData(), pSrcE, batch.Size() * sizeof(T));
+                for (size_t s = 0; s < _hoisted.size(); ++s)
+                    _hoisted[s].layer->Forward(_hoisted[s].src, _hoisted[s].buf, _hoisted[s].dst);
+            }
             for (size_t it = 0; it < _itCount; ++it)
             {
-                for (size_t i = 0; i < _srcExt; ++i)
-                    memcpy(pSrcI, pSrcE + (i * _itCount + it) * _srcInt, _srcInt * sizeof(T));
+                if (_shareSrc && _srcExt == 1)
+                    itSrc->ShareAs(pSrcE + it * _srcInt, _srcInt, itSrc->Shape(), itSrc->Format());
+                else
+                {
+                    T* pSrcI = itSrc->CpuData();
+                    for (size_t i = 0; i < _srcExt; ++i)
+                        memcpy(pSrcI, pSrcE + (i * _itCount + it) * _srcInt, _srcInt * sizeof(T));
+                }
+                if (_hoisting)
+                {
+                    for (size_t v = 0; v < _views.size(); ++v)
+                    {
+                        Tensor& view = *_views[v].first;
+                        view.ShareAs(_views[v].second->CpuData() + it * view.Size(), view.Size(), view.Shape(), view.Format());
+                    }
+                }
 
                 for (size_t s = 0; s < _stages.size(); ++s)
-                    _stages[s].layer->Forward(_stages[s].src, _stages[s].buf, _stages[s].dst);
+                {
+                    if (!(_hoisting && _hoist[s]))
+                        _stages[s].layer->Forward(_stages[s].src, _stages[s].buf, _stages[s].dst);
+                }
 
                 for (size_t b = 0; b < _bLink.size(); ++b)
                 {
@@ -160,6 +211,11 @@ namespace Synet
                 for (size_t o = 0; o < _dstExt; ++o)
                     memcpy(pDstE + (o * _itCount + it) * _dstInt, pDstI, _dstInt * sizeof(T));
             }
+            for (size_t o = 0; o < _oLink.size(); ++o)
+            {
+                const Tensor* oDst = _dst[_oLink[o].first];
+                memcpy(dst[_oLink[o].second]->CpuData(), oDst->CpuData(), oDst->Size() * sizeof(T));
+            }
         }
 
     private:
@@ -176,6 +232,8 @@ namespace Synet
         typedef std::vector<ConnectionParam> ConnectionParams;
         typedef std::pair<size_t, size_t> Link;
         typedef std::vector<Link> Links;
+        typedef std::pair<Tensor*, const Tensor*> View;
+        typedef std::vector<View> Views;
 
         bool _empty;
         LayerSharedPtrs _layers;
@@ -186,6 +244,12 @@ namespace Synet
         Link _itSrc, _itDst;
         Links _iLink, _oLink, _bLink;
         size_t _itCount, _srcAxis, _srcExt, _srcInt, _dstAxis, _dstExt, _dstInt;
+        bool _hoisting, _shareSrc;
+        std::vector<bool> _hoist;
+        Stages _hoisted;
+        LayerSharedPtrs _clones;
+        TensorSharedPtrs _batch;
+        Views _views;
 
         void InitGraph(const TensorPtrs& buf)
         {
@@ -311,5 +375,173 @@ namespace Synet
                 _bLink.push_back(link);
             }
         }
+
+        static bool CanHoist(const LayerParam& param)
+        {
+            switch (param.type())
+            {
+            case LayerTypeInnerProduct:
+                return param.innerProduct().axis() > 0 && !param.innerProduct().transposeA() && 
+                    param.innerProduct().quantizationLevel() == TensorType32f;
+            case LayerTypeElu:
+            case LayerTypeExpandDims:
+            case LayerTypeHswish:
+            case LayerTypeMish:
+            case LayerTypePower:
+            case LayerTypeRelu:
+            case LayerTypeSigmoid:
+            case LayerTypeSoftplus:
+            case LayerTypeSqueeze:
+            case LayerTypeUnaryOperation:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        static bool CanShare(const LayerParam& param)
+        {
+            switch (param.type())
+            {
+            case LayerTypeCast:
+            case LayerTypeConcat:
+            case LayerTypeExpandDims:
+            case LayerTypeFill:
+            case LayerTypeFlatten:
+            case LayerTypeMeta:
+            case LayerTypePermute:
+            case LayerTypePooling:
+            case LayerTypeReshape:
+            case LayerTypeRnnGruBd:
+            case LayerTypeSlice:
+            case LayerTypeSqueeze:
+            case LayerTypeStub:
+            case LayerTypeUnpack:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        void InitHoisting()
+        {
+            const Tensor* itSrc = _src[_itSrc.second];
+            std::set<const Tensor*> outputs(_dst.begin(), _dst.end()), aliases;
+            aliases.insert(itSrc);
+            _shareSrc = true;
+            for (size_t s = 0; s < _stages.size(); ++s)
+            {
+                const Stage& stage = _stages[s];
+                bool alias = false;
+                for (size_t i = 0; i < stage.src.size(); ++i)
+                    alias = alias || aliases.find(stage.src[i]) != aliases.end();
+                for (size_t d = 0; d < stage.dst.size(); ++d)
+                {
+                    if (aliases.find(stage.dst[d]) != aliases.end())
+                        _shareSrc = false;
+                    if (alias && CanShare(stage.layer->Param()))
+                        aliases.insert(stage.dst[d]);
+                }
+            }
+
+            std::map<const Tensor*, Tensor*> batch;
+            _batch.push_back(TensorSharedPtr(new Tensor()));
+            batch[itSrc] = _batch[0].get();
+            _hoist.resize(_stages.size(), false);
+            for (size_t s = 0; s < _stages.size(); ++s)
+            {
+                const Stage& stage = _stages[s];
+                bool hoist = CanHoist(stage.layer->Param()) && stage.src.size();
+                for (size_t i = 0; i < stage.src.size(); ++i)
+                    hoist = hoist && batch.find(stage.src[i]) != batch.end();
+                for (size_t d = 0; d < stage.dst.size(); ++d)
+                    hoist = hoist && outputs.find(stage.dst[d]) == outputs.end() && stage.dst[d] != itSrc;
+                if (!hoist)
+                    continue;
+                LayerSharedPtr clone(Fabric<T>::Create(stage.layer->Param(), this->GetContext(), QuantizationMethodUnknown));
+                clone->Share(*stage.layer);
+                _clones.push_back(clone);
+                Stage hoisted;
+                hoisted.layer = clone.get();
+                hoisted.buf = stage.buf;
+                for (size_t i = 0; i < stage.src.size(); ++i)
+                    hoisted.src.push_back(batch[stage.src[i]]);
+                for (size_t d = 0; d < stage.dst.size(); ++d)
+                {
+                    if (batch.find(stage.dst[d]) == batch.end())
+                    {
+                        TensorSharedPtr tensor(new Tensor());
+                        tensor->SetName(stage.dst[d]->Name());
+                        _batch.push_back(tensor);
+                        _views.push_back(View(stage.dst[d], tensor.get()));
+                        batch[stage.dst[d]] = tensor.get();
+                    }
+                    hoisted.dst.push_back(batch[stage.dst[d]]);
+                }
+                _hoist[s] = true;
+                _hoisted.push_back(hoisted);
+            }
+            if (_hoisted.empty())
+            {
+                _hoist.clear();
+                _batch.clear();
+                _clones.clear();
+            }
+        }
+
+        void ReshapeHoisted(const Tensor* itSrc, const Shape& shape)
+        {
+            Tensor& batch = *_batch[0];
+            Shape batchShape = shape;
+            batchShape[0] *= _itCount;
+            if (_shareSrc)
+                batch.ShareAs(itSrc->CpuData(), itSrc->Size(), batchShape, itSrc->Format());
+            else
+                batch.Reshape(batchShape, itSrc->Format());
+            for (size_t s = 0; s < _hoisted.size(); ++s)
+                _hoisted[s].layer->Reshape(_hoisted[s].src, _hoisted[s].buf, _hoisted[s].dst);
+        }
+
+        bool ReshapeStages(bool hoisting)
+        {
+            for (size_t s = 0; s < _stages.size(); ++s)
+            {
+                if (_hoist.size() && _hoist[s])
+                {
+                    for (size_t v = 0; v < _views.size(); ++v)
+                        if (std::find(_stages[s].dst.begin(), _stages[s].dst.end(), _views[v].first) != _stages[s].dst.end())
+                            _views[v].first->Clear(true);
+                }
+                _stages[s].layer->Reshape(_stages[s].src, _stages[s].buf, _stages[s].dst);
+                if (hoisting && _hoist[s] && !SetViews(_stages[s]))
+                    return false;
+            }
+            return true;
+        }
+
+        bool SetViews(const Stage& stage)
+        {
+            for (size_t d = 0; d < stage.dst.size(); ++d)
+            {
+                for (size_t v = 0; v < _views.size(); ++v)
+                {
+                    if (_views[v].first != stage.dst[d])
+                        continue;
+                    Tensor& view = *_views[v].first;
+                    const Tensor& hoisted = *_views[v].second;
+                    Shape shape = view.Shape();
+                    if (shape.empty() || shape[0] != 1 || hoisted.Count() != shape.size() || hoisted.Axis(0) != _itCount)
+                        return false;
+                    for (size_t i = 1; i < shape.size(); ++i)
+                        if (hoisted.Axis(i) != shape[i])
+                            return false;
+                    TensorFormat format = view.Format();
+                    size_t size = view.Size();
+                    view.Clear(true);
+                    view.ShareAs(hoisted.CpuData(), size, shape, format);
+                }
+            }
+            return true;
+        }
     };
 }
\ No newline at end of file
@@ -42,6 +42,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return true;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             assert(src.size() == 1);
@@ -51,16 +56,25 @@ namespace Synet
             _inner = src[0]->Size(_axis);
             Shape shape = src[0]->Shape();
             shape[_axis] *= _tiles;
-            dst[0]->Reshape(shape, src[0]->Format());
+            _src8u = src[0]->GetType() == TensorType8u;
+            if (_src8u)
+                dst[0]->As8u().Reshape(shape, src[0]->Format());
+            else
+                dst[0]->As32f().Reshape(shape, src[0]->Format());
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             SYNET_PERF_FUNC();
+            if (_src8u)
+                ForwardCpu(src[0]->As8u().CpuData(), dst[0]->As8u().CpuData());
+            else
+                ForwardCpu(src[0]->As32f().CpuData(), dst[0]->As32f().CpuData());
+        }
 
-            const T * pSrc = src[0]->CpuData();
-            T * pDst = dst[0]->CpuData();
+        template<class TT> void ForwardCpu(const TT * pSrc, TT * pDst)
+        {
             if (_inner == 1)
             {
                 for (size_t o = 0; o < _outer; ++o, pDst += _tiles)
@@ -82,5 +96,6 @@ namespace Synet
 
     private:
         size_t _axis, _tiles, _outer, _inner;
+        bool _src8u;
     };
 }
\ No newline at end of file
@@ -107,6 +107,11 @@ namespace Synet
         {
         }
 
+        virtual bool Can8i() const
+        {
+            return this->Param().upsample().scale() == 1.0f;
+        }
+
         virtual void Reshape(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             const UpsampleParam & param = this->Param().upsample();
@@ -158,19 +163,42 @@ namespace Synet
                     shape[3] *= _stride;
                 }            
             }
-            dst[0]->Reshape(shape, src[0]->Format());
+            _dstSize = shape[1] * shape[2] * shape[3];
+            _src8u = src[0]->GetType() == TensorType8u;
+            if (_src8u)
+            {
+                assert(_scale == 1.0f);
+                dst[0]->As8u().Reshape(shape, src[0]->Format());
+            }
+            else
+                dst[0]->As32f().Reshape(shape, src[0]->Format());
             this->UsePerfStat();
         }
 
     protected:
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
-            Detail::UpsampleLayerForwardCpu(src[0]->CpuData(), _channel, _height, _width, _stride, _scale, _reverse, _trans, dst[0]->CpuData());
+            if (_src8u)
+                ForwardCpu(src[0]->As8u().CpuData(), uint8_t(1), dst[0]->As8u().CpuData());
+            else
+                ForwardCpu(src[0]->As32f().CpuData(), _scale, dst[0]->As32f().CpuData());
+        }
+
+        template<class TT> void ForwardCpu(const TT * src, TT scale, TT * dst)
+        {
+            size_t size = _channel * _height * _width;
+            for (size_t n = 0; n < _num; ++n)
+            {
+                Detail::UpsampleLayerForwardCpu(src, _channel, _height, _width, _stride, scale, _reverse, _trans, dst);
+                src += size;
+                dst += _dstSize;
+            }
         }
 
     private:
         int _reverse, _trans;
-        size_t _stride, _num, _channel, _height, _width;
+        bool _src8u;
+        size_t _stride, _num, _channel, _height, _width, _dstSize;
         float _scale;
     };
 }
\ No newline at end of file
@@ -56,40 +56,45 @@ namespace Synet
             for (size_t i = 0; i < param.mask().size(); ++i)
                 _mask[i] = param.mask()[i];            
             
+            _trans = src[0]->Format() == TensorFormatNhwc;
             Shape dstShape = src[0]->Shape();
-            dstShape[1] = _num*(_classes + 4 + 1);
+            dstShape[_trans ? 3 : 1] = _num*(_classes + 4 + 1);
             dst[0]->Reshape(dstShape, src[0]->Format());
             this->UsePerfStat();
         }
 
-        void GetRegions(const TensorPtrs & src, size_t netW, size_t netH, Type threshold, Regions & dst) const
+        void GetRegions(const TensorPtrs & src, size_t netW, size_t netH, Type threshold, Regions & dst, size_t batch = 0) const
         {
             SYNET_PERF_FUNC();
             dst.clear();
-            size_t b = 0;
-            size_t layerH = src[0]->Axis(2);
-            size_t layerW = src[0]->Axis(3);
-            for (size_t y = 0; y < layerH; ++y)
+            bool trans = src[0]->Format() == TensorFormatNhwc;
+            size_t layerH = src[0]->Axis(trans ? 1 : 2);
+            size_t layerW = src[0]->Axis(trans ? 2 : 3);
+            size_t size = _classes + 5, area = layerH * layerW;
+            size_t cStep = trans ? 1 : area, pStep = trans ? _num * size : 1;
+            const Type * pSrc = src[0]->CpuData() + batch * src[0]->Size(1);
+            for (size_t y = 0, p = 0; y < layerH; ++y)
             {
-                for (size_t x = 0; x < layerW; ++x)
+                for (size_t x = 0; x < layerW; ++x, ++p)
                 {
                     for (size_t n = 0; n < _num; ++n)
                     {
-                        Type objectness = src[0]->CpuData({ b, n*(_classes + 5) + 4, y, x })[0];
-                        if (objectness > threshold)
+                        const Type * pAnchor = pSrc + p * pStep + n * size * cStep;
+                        Type objectness = pAnchor[4 * cStep];
+                        if (objectness <= threshold)
+                            continue;
+                        Region region;
+                        region.x = (x + pAnchor[0 * cStep]) / layerW;
+                        region.y = (y + pAnchor[1 * cStep]) / layerH;
+                        region.w = ::exp(pAnchor[2 * cStep])*_anchors[2*_mask[n] + 0] / netW;
+                        region.h = ::exp(pAnchor[3 * cStep])*_anchors[2*_mask[n] + 1] / netH;
+                        const Type * pClass = pAnchor + 5 * cStep;
+                        for (size_t i = 0; i < _classes; ++i)
                         {
-                            Region region;
-                            region.x = (x + src[0]->CpuData({ b, n*(_classes + 5) + 0, y, x })[0]) / layerW;
-                            region.y = (y + src[0]->CpuData({ b, n*(_classes + 5) + 1, y, x })[0]) / layerH;
-                            region.w = ::exp(src[0]->CpuData({ b, n*(_classes + 5) + 2, y, x })[0])*_anchors[2*_mask[n] + 0] / netW;
-                            region.h = ::exp(src[0]->CpuData({ b, n*(_classes + 5) + 3, y, x })[0])*_anchors[2*_mask[n] + 1] / netH;
-                            for (size_t i = 0; i < _classes; ++i)
-                            {
-                                region.id = i;
-                                region.prob = objectness*src[0]->CpuData({ b, n*(_classes + 5) + 5 + i, y, x })[0];
-                                if (region.prob > threshold)
-                                    dst.push_back(region);
-                            }
+                            region.id = i;
+                            region.prob = objectness*pClass[i * cStep];
+                            if (region.prob > threshold)
+                                dst.push_back(region);
                         }
                     }
                 }
@@ -100,6 +105,28 @@ namespace Synet
         virtual void ForwardCpu(const TensorPtrs & src, const TensorPtrs & buf, const TensorPtrs & dst)
         {
             size_t batch = src[0]->Axis(0);
+            if (_trans)
+            {
+                size_t size = _classes + 5, count = batch * src[0]->Axis(1) * src[0]->Axis(2) * _num;
+                const Type * pSrc = src[0]->CpuData();
+                Type * pDst = dst[0]->CpuData();
+                if (pSrc == pDst)
+                {
+                    for (size_t i = 0; i < count; ++i, pDst += size)
+                    {
+                        CpuSigmoid(pDst + 0, 2, pDst + 0);
+                        CpuSigmoid(pDst + 4, _classes + 1, pDst + 4);
+                    }
+                    return;
+                }
+                CpuSigmoid(pSrc, count * size, pDst);
+                for (size_t i = 0; i < count; ++i, pSrc += size, pDst += size)
+                {
+                    pDst[2] = pSrc[2];
+                    pDst[3] = pSrc[3];
+                }
+                return;
+            }
             size_t area = src[0]->Axis(2)*src[0]->Axis(3);
             Index index(4, 0);
             for (index[0] = 0; index[0] < batch; ++index[0])
@@ -121,6 +148,7 @@ namespace Synet
         typedef std::vector<size_t> VectorI;
 
         size_t _total, _num, _classes;
+        bool _trans;
         VectorF _anchors;
         VectorI _mask;
     };
@@ -29,6 +29,10 @@
 
 #include "Synet/Utils/SetInput.h"
 #include "Synet/Utils/Statistics.h"
+#include "Synet/Utils/MemoryPlanner.h"
+#include "Synet/Utils/FileUtils.h"
+#include "Synet/Utils/GraphExecutor.h"
+#include "Synet/Utils/Profiler.h"
 
 namespace Synet
 {
@@ -46,6 +50,7 @@ namespace Synet
 
         Network()
             : _empty(true)
+            , _compact(false)
         {
         }
 
@@ -65,6 +70,7 @@ namespace Synet
             _layers.clear();
             _tensors.clear();
             _stats.clear();
+            _histograms.clear();
             _input.clear();
             _stages.clear();
             _stats.clear();
@@ -76,11 +82,26 @@ namespace Synet
             _statId.clear();
             _srcIds.clear();
             _dstIds.clear();
+            _planned.clear();
+            _planner.Clear();
+            _arena.Resize(0);
+            _executor.reset();
+            _workBufs.clear();
+            _profiler.Clear();
+            _mapped.reset();
+            _origin.clear();
+            _plans.clear();
+            _key = PlanKey();
+            _context.tuning.Clear();
             _empty = true;
+            _compact = false;
         }
 
         bool Load(const String & model, const String & weight, const Options & options = Options())
         {
+            if (IsBinary(model))
+                return LoadBinary(model, options);
+
             Clear();
 
             if (!_param.Load(model))
@@ -115,7 +136,16 @@ namespace Synet
         {
             Clear();
 
-            if (!_param.Load(modelData, modelSize))
+            if (NetworkParamHolder::IsBinary(modelData, modelSize))
+            {
+                const char* embeddedData = NULL;
+                size_t embeddedSize = 0;
+                if (!_param.LoadBinary(modelData, modelSize, &embeddedData, &embeddedSize))
+                    return false;
+                if (weightData == NULL)
+                    weightData = embeddedData, weightSize = embeddedSize;
+            }
+            else if (!_param.Load(modelData, modelSize))
                 return false;
             _context.options = options;
             CreateLayers();
@@ -129,11 +159,176 @@ namespace Synet
             return Init();
         }
 
+        bool LoadMapped(const String & model, const String & weight, const Options & options = Options())
+        {
+            Clear();
+
+            if (!_param.Load(model))
+            {
+                std::cout << "Can't load model file '" << model << "' !" << std::endl;
+                return false;
+            }
+            _context.options = options;
+            CreateLayers();
+
+            _mapped.reset(new MappedFile());
+            if (!_mapped->Open(weight))
+            {
+                std::cout << "Can't map weight file '" << weight << "' !" << std::endl;
+                return false;
+            }
+            const char * data = _mapped->Data();
+            size_t size = _mapped->Size();
+            for (size_t i = 0; i < _layers.size(); ++i)
+            {
+                if (!_layers[i]->Load(data, size, _layers, true))
+                {
+                    std::cout << "Can't load weight from file '" << weight << "' !" << std::endl;
+                    return false;
+                }
+            }
+
+            return Init();
+        }
+
+        bool LoadBinary(const String & model, const Options & options = Options())
+        {
+            Clear();
+
+            _mapped.reset(new MappedFile());
+            if (!_mapped->Open(model))
+            {
+                std::cout << "Can't map model file '" << model << "' !" << std::endl;
+                return false;
+            }
+            const char * data = NULL;
+            size_t size = 0;
+            if (!_param.LoadBinary(_mapped->Data(), _mapped->Size(), &data, &size))
+            {
+                std::cout << "Can't load binary model file '" << model << "' !" << std::endl;
+                return false;
+            }
+            _context.options = options;
+            CreateLayers();
+
+            for (size_t i = 0; i < _layers.size(); ++i)
+            {
+                if (!_layers[i]->Load(data, size, _layers, true))
+                {
+                    std::cout << "Can't load weight from binary model file '" << model << "' !" << std::endl;
+                    return false;
+                }
+            }
+
+            return Init();
+        }
+
+        static bool IsBinary(const String & model)
+        {
+            char data[64];
+            std::ifstream ifs(model.c_str(), std::ifstream::binary);
+            if (!ifs.is_open())
+                return false;
+            ifs.read(data, sizeof(data));
+            return NetworkParamHolder::IsBinary(data, (size_t)ifs.gcount());
+        }
+
+        bool Clone(Network & network) const
+        {
+            network.Clear();
+            if (_empty)
+                return false;
+            if (_compact)
+            {
+                std::cout << "Can't clone network with compacted weights!" << std::endl;
+                return false;
+            }
+
+            network._param() = _param();
+            network._context.options = _context.options;
+            network.CreateLayers();
+            if (network._layers.size() != _layers.size())
+                return false;
+            for (size_t i = 0; i < _layers.size(); ++i)
+                network._layers[i]->Share(*_layers[i]);
+            network._origin = _origin.empty() ? _layers : _origin;
+            network._mapped = _mapped;
+            if (!network.Init())
+                return false;
+
+            Strings srcNames, dstNames;
+            Shapes srcShapes;
+            bool changed = false;
+            for (size_t i = 0; i < _input.size(); ++i)
+            {
+                const LayerParam & param = _input[i].layer->Param();
+                if (param.type() != LayerTypeInput)
+                    continue;
+                srcNames.push_back(param.name());
+                srcShapes.push_back(_input[i].dst[0]->Shape());
+                changed = changed || srcShapes.back() != network._input[i].dst[0]->Shape();
+            }
+            for (size_t i = 0; i < _dst.size(); ++i)
+            {
+                for (NameIdMap::const_iterator it = _tensorId.begin(); it != _tensorId.end(); ++it)
+                    if (_tensors[it->second].get() == _dst[i])
+                        dstNames.push_back(it->first);
+            }
+            if (dstNames.size() != network._dst.size())
+                changed = true;
+            for (size_t i = 0; i < dstNames.size() && !changed; ++i)
+                changed = network._tensorId.find(dstNames[i]) == network._tensorId.end() ||
+                    network._tensors[network._tensorId.at(dstNames[i])].get() != network._dst[i];
+            return changed ? network.Reshape(srcNames, srcShapes, dstNames) : true;
+        }
+
         bool Save(const String& model) const
         {
             return _param.Save(model, false);
         }
 
+        bool SaveBinary(const String& model) const
+        {
+            if (_compact)
+            {
+                std::cout << "Can't save binary model with compacted weights!" << std::endl;
+                return false;
+            }
+            NetworkParamHolder param;
+            param() = _param();
+            std::map<String, const Layer*> layers;
+            for (size_t i = 0; i < _layers.size(); ++i)
+                layers[_layers[i]->Param().name()] = _layers[i].get();
+            size_t end = 0;
+            for (size_t i = 0; i < param().layers().size(); ++i)
+            {
+                const std::vector<WeightParam>& weight = param().layers()[i].weight();
+                for (size_t j = 0; j < weight.size(); ++j)
+                    if ((ptrdiff_t)weight[j].offset() >= 0)
+                        end = Max(end, weight[j].offset() + weight[j].size());
+            }
+            std::vector<char> data(end, 0);
+            for (size_t i = 0; i < param().layers().size(); ++i)
+            {
+                std::vector<WeightParam>& weight = param().layers()[i].weight();
+                if (weight.empty() || layers.find(param().layers()[i].name()) == layers.end())
+                    continue;
+                const std::vector<Tensor>& tensors = layers[param().layers()[i].name()]->Weight();
+                for (size_t j = 0; j < weight.size() && j < tensors.size(); ++j)
+                {
+                    if ((ptrdiff_t)weight[j].offset() < 0)
+                    {
+                        data.resize(DivHi(data.size(), 64) * 64, 0);
+                        weight[j].offset() = data.size();
+                        weight[j].size() = tensors[j].RawSize();
+                        data.resize(data.size() + tensors[j].RawSize(), 0);
+                    }
+                    memcpy(data.data() + weight[j].offset(), tensors[j].RawCpuData(), Min(weight[j].size(), tensors[j].RawSize()));
+                }
+            }
+            return param.SaveBinary(model, data.data(), data.size());
+        }
+
         TensorPtrs & Src() 
         { 
             return _src; 
@@ -170,8 +365,17 @@ namespace Synet
                 return false;
             }
 
+            PlanKey key;
+            if (_context.options.reshapeCacheSize && srcNames.size())
+            {
+                key = PlanKey(srcNames, srcShapes, dstNames.size() ? dstNames : DstNames());
+                if (RestorePlan(key))
+                    return true;
+            }
+
             for (size_t i = 0; i < _tensors.size(); ++i)
                 _tensors[i]->Clear(true);
+            ReleaseMemory();
 
             if (srcNames.size())
             {
@@ -217,16 +421,17 @@ namespace Synet
 
             ReshapeStages();
 
-            if (dstNames.size())
+            const Strings & names = key.srcNames.size() ? key.dstNames : dstNames;
+            if (names.size())
             {
                 _dst.clear();
-                for (size_t i = 0; i < dstNames.size(); ++i)
+                for (size_t i = 0; i < names.size(); ++i)
                 {
                     bool found = false;
                     for (size_t j = 0; j < _stages.size(); ++j)
                     {
                         const LayerParam & param = _stages[j].layer->Param();
-                        if (param.name() == dstNames[i])
+                        if (param.name() == names[i])
                         {
                             _dst.push_back(_stages[j].dst[0]);
                             found = true;
@@ -235,11 +440,14 @@ namespace Synet
                     }
                     if (!found)
                     {
-                        std::cout << "Output layer '" << dstNames[i] << "' is not found!" << std::endl;
+                        std::cout << "Output layer '" << names[i] << "' is not found!" << std::endl;
                         return false;
                     }
                 }
             }
+            PlanMemory();
+            InitExecutor();
+            _key = key;
 
             return true;
         }
@@ -278,8 +486,14 @@ namespace Synet
             }
             else
                 return false;
+            if (_context.options.reshapeCacheSize)
+                return Reshape(Strings({ param.name() }), Shapes({ shape }));
+            ReleaseMemory();
             _input[0].dst[0]->Reshape(shape, Type(0), format);
             ReshapeStages();
+            PlanMemory();
+            InitExecutor();
+            _key = PlanKey();
             return true;
         }
 
@@ -353,6 +567,30 @@ namespace Synet
             //SYNET_PERF_FUNC();
             bool mode = GetFastMode();
             SetFastMode(true);
+            if (_context.options.profiling != Options::ProfilingEmpty)
+            {
+                for (size_t i = 0; i < _stages.size(); ++i)
+                {
+                    const Stage & stage = _stages[i];
+                    const LayerParam & param = stage.layer->Param();
+                    _profiler.Start();
+                    stage.layer->Forward(stage.src, stage.buf, stage.dst);
+                    _profiler.Stop(i, param.name(), ValueToString(param.type()), stage.layer->Flop(), Bytes(stage));
+                }
+                SetFastMode(mode);
+                return;
+            }
+            if (_executor && _executor->Threads() > 1)
+            {
+                _executor->Run([this](size_t stage, size_t thread)
+                {
+                    if (thread)
+                        SetFastMode(true);
+                    _stages[stage].layer->Forward(_stages[stage].src, _workBufs[thread], _stages[stage].dst);
+                });
+                SetFastMode(mode);
+                return;
+            }
             for (size_t i = 0; i < _stages.size(); ++i)
             {
 #if 0
@@ -367,6 +605,50 @@ namespace Synet
             SetFastMode(mode);
         }
 
+        void Forward(size_t begin, size_t end)
+        {
+            bool mode = GetFastMode();
+            SetFastMode(true);
+            for (size_t i = begin, n = std::min(end, _stages.size()); i < n; ++i)
+                _stages[i].layer->Forward(_stages[i].src, _stages[i].buf, _stages[i].dst);
+            SetFastMode(mode);
+        }
+
+        Synet::Profiler & Profile()
+        {
+            return _profiler;
+        }
+
+        const Synet::Profiler & Profile() const
+        {
+            return _profiler;
+        }
+
+        bool SaveProfile(const String & path, bool trace = false) const
+        {
+            std::ofstream ofs(path.c_str());
+            if (!ofs.is_open())
+            {
+                std::cout << "Can't open profile file '" << path << "' !" << std::endl;
+                return false;
+            }
+            if (trace)
+                _profiler.WriteTrace(ofs);
+            else
+                _profiler.WriteJson(ofs);
+            return true;
+        }
+
+        size_t StageCount() const
+        {
+            return _stages.size();
+        }
+
+        const Layer * StageLayer(size_t index) const
+        {
+            return _stages[index].layer;
+        }
+
         void UpdateStatistics(float quantile, float epsilon)
         {
             SYNET_PERF_FUNC();
@@ -374,6 +656,86 @@ namespace Synet
                  UpdateStatistics(*_tensors[i], quantile, epsilon);
         }
 
+        bool MergeStatistics(const Network & network)
+        {
+            typedef std::vector<StatisticParam> StatisticParams;
+            StatisticParams & dst = _param().quantization().statistics();
+            const StatisticParams & src = network._param().quantization().statistics();
+            NameIdMap statId;
+            for (size_t i = 0; i < dst.size(); ++i)
+                statId[dst[i].name()] = i;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                NameIdMap::const_iterator it = statId.find(src[i].name());
+                if (it == statId.end())
+                {
+                    statId[src[i].name()] = dst.size();
+                    dst.push_back(src[i]);
+                    continue;
+                }
+                StatisticParam & stat = dst[it->second];
+                if (stat.min().size() != src[i].min().size() || stat.max().size() != src[i].max().size())
+                {
+                    std::cout << "Can't merge statistics of '" << stat.name() << "' tensor: different channel number!" << std::endl;
+                    return false;
+                }
+                Detail::UpdateMinMax(src[i].min().data(), src[i].max().data(), stat.min().size(), stat.min().data(), stat.max().data());
+            }
+            for (std::map<String, CalibrationHistogram>::const_iterator it = network._histograms.begin(); it != network._histograms.end(); ++it)
+            {
+                if (!_histograms[it->first].Merge(it->second))
+                {
+                    std::cout << "Can't merge calibration histogram of '" << it->first << "' tensor!" << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void UpdateHistograms(CalibrationMethod method, size_t size)
+        {
+            SYNET_PERF_FUNC();
+            std::vector<StatisticParam> & stats = _param().quantization().statistics();
+            NameIdMap statId;
+            for (size_t i = 0; i < stats.size(); ++i)
+                statId[stats[i].name()] = i;
+            for (size_t i = 0; i < _tensors.size(); ++i)
+            {
+                const Tensor & tensor = *_tensors[i];
+                if (tensor.Name().empty() || tensor.GetType() != TensorType32f || GetChannels(tensor) == 0)
+                    continue;
+                NameIdMap::const_iterator it = statId.find(tensor.Name());
+                if (it == statId.end() || stats[it->second].min().size() != GetChannels(tensor))
+                    continue;
+                CalibrationHistogram & histogram = _histograms[tensor.Name()];
+                if (!histogram.Enable())
+                {
+                    const StatisticParam& stat = stats[it->second];
+                    histogram.Init(stat.min().data(), stat.max().data(), stat.min().size(), size, method == CalibrationMethodPercentile);
+                }
+                histogram.Update(tensor);
+            }
+        }
+
+        void CalibrateStatistics(CalibrationMethod method, float percentile, QuantizationMethod quantization)
+        {
+            std::vector<StatisticParam>& stats = _param().quantization().statistics();
+            for (size_t i = 0; i < stats.size(); ++i)
+            {
+                std::map<String, CalibrationHistogram>::const_iterator it = _histograms.find(stats[i].name());
+                if (it == _histograms.end() || !it->second.Enable())
+                    continue;
+                bool negative = false;
+                for (size_t c = 0; c < stats[i].min().size(); ++c)
+                    negative = negative || stats[i].min()[c] < 0.0f;
+                int levels = quantization == QuantizationMethodIECompatible ? 
+                    (negative ? QUANT_IE_COMP_SRC_I8_MAX : QUANT_IE_COMP_SRC_U8_MAX) :
+                    (negative ? QUANT_SYMM_NARR_SRC_I8_MAX : QUANT_SYMM_NARR_SRC_U8_MAX);
+                it->second.Calibrate(method, percentile, levels, stats[i].min().data(), stats[i].max().data());
+            }
+            _histograms.clear();
+        }
+
         void DebugPrint(std::ostream & os, int flag, int first, int last, int precision)
         {
             bool printOutput = (flag & (1 << DebugPrintOutput)) != 0;
@@ -433,12 +795,12 @@ namespace Synet
             }
         }
 
-        Regions GetRegions(size_t imageW, size_t imageH, Type threshold, Type overlap) const
+        Regions GetRegions(size_t imageW, size_t imageH, Type threshold, Type overlap, size_t batch = 0) const
         {
             const Shape & netNCHW = NchwShape();
             size_t netH = netNCHW[2];
             size_t netW = netNCHW[3];
-            Regions regions;
+            Regions regions, candidats;
             for (size_t i = 0; i < _dst.size(); ++i)
             {
                 TensorPtrs dst(1, _dst[i]);
@@ -454,37 +816,39 @@ namespace Synet
                         }
                     }
                 }
-                Regions candidats;
+                Regions layerRegions;
                 if (layer->Param().type() == Synet::LayerTypeYolo)
-                    ((YoloLayer<float>*)layer)->GetRegions(dst, netW, netH, threshold, candidats);
+                    ((YoloLayer<float>*)layer)->GetRegions(dst, netW, netH, threshold, layerRegions, batch);
                 if (layer->Param().type() == Synet::LayerTypeRegion)
-                    ((RegionLayer<float>*)layer)->GetRegions(dst, threshold, candidats);
+                    ((RegionLayer<float>*)layer)->GetRegions(dst, threshold, layerRegions, batch);
                 if (layer->Param().type() == Synet::LayerTypeDetectionOutput)
-                    ((DetectionOutputLayer<float>*)layer)->GetRegions(dst, threshold, candidats);
-                for (size_t j = 0; j < candidats.size(); ++j)
+                    ((DetectionOutputLayer<float>*)layer)->GetRegions(dst, threshold, layerRegions, batch);
+                for (size_t j = 0; j < layerRegions.size(); ++j)
                 {
-                    Region & c = candidats[j];
+                    Region & c = layerRegions[j];
                     c.x *= imageW;
                     c.w *= imageW;
                     c.y *= imageH;
                     c.h *= imageH;
+                    candidats.push_back(c);
+                }
+            }
+            std::stable_sort(candidats.begin(), candidats.end(), [](const Region & a, const Region & b) 
+                { return a.id < b.id || (a.id == b.id && a.prob > b.prob); });
+            for (size_t begin = 0, end = 0; begin < candidats.size(); begin = end)
+            {
+                size_t first = regions.size();
+                for (end = begin; end < candidats.size() && candidats[end].id == candidats[begin].id; ++end)
+                {
+                    const Region & c = candidats[end];
                     bool insert = true;
-                    for (size_t k = 0; k < regions.size(); ++k)
-                    {
-                        Region & r = regions[k];
-                        if (c.id == r.id && Overlap(c, r) >= overlap)
-                        {
-                            if (c.prob > r.prob)
-                               r = c;
-                            insert = false;
-                            break;
-                        }
-                    }
+                    for (size_t k = first; k < regions.size() && insert; ++k)
+                        insert = !(Overlap(c, regions[k]) >= overlap);
                     if (insert)
                         regions.push_back(c);
                 }
             }
-            std::sort(regions.begin(), regions.end(), [](const Region & a, const Region & b) {return a.prob > b.prob; });
+            std::stable_sort(regions.begin(), regions.end(), [](const Region & a, const Region & b) {return a.prob > b.prob; });
             return regions;
         }
 
@@ -501,7 +865,8 @@ namespace Synet
                     const void * ptr = _layers[i]->Weight()[j].RawCpuData();
                     if (unique.find(ptr) == unique.end())
                     {
-                        memoryUsage += _layers[i]->Weight()[j].MemoryUsage();
+                        if (_origin.empty())
+                            memoryUsage += _layers[i]->Weight()[j].MemoryUsage();
                         unique.insert(ptr);
                     }
                 }
@@ -518,13 +883,25 @@ namespace Synet
             }
             for (size_t i = 0; i < _stats.size(); ++i)
                 memoryUsage += _stats[i]->MemoryUsage();
+            memoryUsage += _arena.size;
             return memoryUsage;
         }
 
+        size_t PlannedMemory() const
+        {
+            return _planner.Size();
+        }
+
+        size_t NaiveMemory() const
+        {
+            return _planner.NaiveSize();
+        }
+
         void CompactWeight()
         {
             for (size_t i = 0; i < _layers.size(); ++i)
                 _layers[i]->CompactWeight();
+            _compact = true;
         }
 
         int64_t Flop() const
@@ -574,12 +951,13 @@ namespace Synet
         };
         typedef std::vector<Stage> Stages;
 
-        bool _empty;
+        bool _empty, _compact;
         NetworkParamHolder _param;
         Context _context;
         LayerSharedPtrs _layers;
         TensorSharedPtrs _tensors;
         StatSharedPtrs _stats;
+        std::map<String, CalibrationHistogram> _histograms;
 
         Stages _input, _stages;
         TensorPtrs _src, _dst;
@@ -587,6 +965,81 @@ namespace Synet
         NameIdMap _tensorId, _layerId, _statId;
         NameIdSetMap _srcIds, _dstIds;
 
+        struct Lifetime
+        {
+            size_t begin, end, size;
+            bool owner, fixed;
+            TensorPtrs tensors;
+        };
+        typedef std::map<const uint8_t*, Lifetime> Lifetimes;
+
+        struct Slice
+        {
+            const uint8_t * parent;
+            size_t offset;
+
+            Slice(const uint8_t * parent_ = NULL, size_t offset_ = 0)
+                : parent(parent_)
+                , offset(offset_)
+            {
+            }
+        };
+        typedef std::map<const uint8_t*, Slice> Slices;
+
+        MemoryPlanner _planner;
+        Synet::Buffer<uint8_t> _arena;
+        TensorPtrs _planned;
+
+        std::unique_ptr<GraphExecutor> _executor;
+        std::vector<TensorPtrs> _workBufs;
+        Synet::Profiler _profiler;
+
+        std::shared_ptr<MappedFile> _mapped;
+        LayerSharedPtrs _origin;
+
+        struct PlanKey
+        {
+            Strings srcNames, dstNames;
+            Shapes srcShapes;
+
+            PlanKey()
+            {
+            }
+
+            PlanKey(const Strings & srcNames_, const Shapes & srcShapes_, const Strings & dstNames_)
+                : srcNames(srcNames_)
+                , dstNames(dstNames_)
+                , srcShapes(srcShapes_)
+            {
+            }
+
+            bool operator == (const PlanKey & other) const
+            {
+                return srcNames == other.srcNames && srcShapes == other.srcShapes && dstNames == other.dstNames;
+            }
+        };
+
+        struct Plan
+        {
+            PlanKey key;
+            LayerSharedPtrs layers;
+            TensorSharedPtrs tensors;
+            StatSharedPtrs stats;
+            Stages input, stages;
+            TensorPtrs src, dst;
+            LayerPtrs back;
+            NameIdMap tensorId, layerId, statId;
+            NameIdSetMap srcIds, dstIds;
+            MemoryPlanner planner;
+            Synet::Buffer<uint8_t> arena;
+            TensorPtrs planned;
+            std::vector<TensorPtrs> workBufs;
+        };
+        typedef std::list<Plan> Plans;
+
+        PlanKey _key;
+        Plans _plans;
+
         void CreateLayers()
         {
             NameIdMap layerId;
@@ -607,8 +1060,11 @@ namespace Synet
             }
         }
 
-        bool Init()
+        bool Init(bool reshape = true)
         {
+            _profiler.Init(_context.options.profiling == Options::ProfilingCounters);
+            if (_context.options.tuningCache.size())
+                _context.tuning.Load(_context.options.tuningCache);
             TensorPtrs buf;
             SetBuffers(buf);
             SetStats();
@@ -691,10 +1147,10 @@ namespace Synet
             }
             if (Is8i())
             {
-                SetTensorTypes();
                 UnifyStats();
+                SetTensorTypes();
             }
-            if (!Dynamic())
+            if (reshape && !Dynamic())
                 Reshape();
             _empty = false;
             return true;
@@ -719,7 +1175,7 @@ namespace Synet
                         continue;
                     if (dst.layer->Param().type() == LayerTypePriorBox)
                         continue;
-                    if (dst.layer->Can8i() && Is8iInSubGraph(dst))
+                    if (dst.layer->Can8i() && IsUnifiedMovement(dst) && Is8iInSubGraph(dst))
                         continue;
                     return false;
                 }
@@ -742,6 +1198,7 @@ namespace Synet
                         continue;
                     if (dst.layer->Is8i())
                         continue;
+                    assert(IsUnifiedMovement(dst));
                     Set8iInSubGraph(dst);
                 }
             }
@@ -760,6 +1217,47 @@ namespace Synet
                 if (Is8iInSubGraph(_stages[s]))
                     Set8iInSubGraph(_stages[s]);
             }
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (size_t s = 0; s < _stages.size(); ++s)
+                {
+                    const Stage& stage = _stages[s];
+                    if (stage.layer->Is8i() || stage.layer->Param().type() == LayerTypePriorBox)
+                        continue;
+                    bool is8u = false, is32f = false;
+                    for (size_t i = 0; i < stage.src.size(); ++i)
+                        (stage.src[i]->GetType() == TensorType8u ? is8u : is32f) = true;
+                    for (size_t i = 0; i < stage.dst.size(); ++i)
+                        (stage.dst[i]->GetType() == TensorType8u ? is8u : is32f) = true;
+                    if (!(is8u && is32f))
+                        continue;
+                    const LayerParam& param = stage.layer->Param();
+                    for (size_t i = 0; i < param.src().size(); ++i)
+                        if (_tensors[_tensorId[param.src()[i]]]->GetType() == TensorType8u)
+                            Set32fInSubGraph(param.src()[i]);
+                    for (size_t i = 0; i < param.dst().size(); ++i)
+                        if (_tensors[_tensorId[param.dst()[i]]]->GetType() == TensorType8u)
+                            Set32fInSubGraph(param.dst()[i]);
+                    changed = true;
+                }
+            }
+        }
+
+        void Set32fInSubGraph(const String & name)
+        {
+            _tensors[_tensorId[name]]->SetType(TensorType32f);
+            const IdSet & ids = _srcIds[name];
+            for (IdSet::const_iterator id = ids.begin(); id != ids.end(); ++id)
+            {
+                const Stage & dst = _stages[*id];
+                if (dst.layer->Is8i())
+                    continue;
+                const LayerParam & param = dst.layer->Param();
+                for (size_t d = 0; d < param.dst().size(); ++d)
+                    if (_tensors[_tensorId[param.dst()[d]]]->GetType() == TensorType8u)
+                        Set32fInSubGraph(param.dst()[d]);
+            }
         }
 
         bool IsSubGraphEndConv(size_t s)
@@ -793,6 +1291,48 @@ namespace Synet
             return true;
         }
 
+        static bool IsDataMovement(const LayerParam & param)
+        {
+            switch (param.type())
+            {
+            case LayerTypeExpandDims:
+            case LayerTypeFlatten:
+            case LayerTypeInterp:
+            case LayerTypeInterp2:
+            case LayerTypePermute:
+            case LayerTypeReorg:
+            case LayerTypeReshape:
+            case LayerTypeSlice:
+            case LayerTypeSqueeze:
+            case LayerTypeStridedSlice:
+            case LayerTypeTile:
+                return true;
+            case LayerTypeUpsample:
+                return param.upsample().scale() == 1.0f;
+            default:
+                return false;
+            }
+        }
+
+        bool IsUnified(const String & name) const
+        {
+            NameIdMap::const_iterator it = _statId.find(name);
+            return it != _statId.end() && !_stats[it->second]->channels;
+        }
+
+        bool IsUnifiedMovement(const Stage & stage) const
+        {
+            const LayerParam & param = stage.layer->Param();
+            if (!IsDataMovement(param) || param.type() == LayerTypeInterp || param.type() == LayerTypeInterp2)
+                return true;
+            if (!IsUnified(param.src()[0]))
+                return false;
+            for (size_t d = 0; d < param.dst().size(); ++d)
+                if (!IsUnified(param.dst()[d]))
+                    return false;
+            return true;
+        }
+
         void UnifyStats()
         {
             if (_param().quantization().method() == QuantizationMethodSymmetricNarrowed)
@@ -811,6 +1351,11 @@ namespace Synet
                         _stats[_statId[param.dst()[0]]]->UnifyAs(*_stats[_statId[param.src()[0]]]);
                     if (param.type() == LayerTypeRelu && param.relu().negativeSlope() == 0.0f)
                         _stats[_statId[param.dst()[0]]]->UnifyAs(*_stats[_statId[param.src()[0]]]);
+                    if (IsDataMovement(param) && !_stats[_statId[param.src()[0]]]->channels)
+                    {
+                        for (size_t d = 0; d < param.dst().size(); ++d)
+                            _stats[_statId[param.dst()[d]]]->UnifyAs(*_stats[_statId[param.src()[0]]]);
+                    }
                     if (param.type() == LayerTypeConcat)
                     {
                         StatPtrs stats;
@@ -830,6 +1375,340 @@ namespace Synet
                 if (_stages[i].layer->_isBack && _stages[i].layer->Param().type() != LayerTypeStub)
                     _stages[i].dst[0]->SetName(_stages[i].layer->Param().name());
             }
+            if (_context.tuning.Changed() && _context.options.tuningCache.size())
+                _context.tuning.Save(_context.options.tuningCache);
+        }
+
+        bool IsConst(const Layer & layer) const
+        {
+            const LayerParam & param = layer.Param();
+            switch (param.type())
+            {
+            case LayerTypeConst:
+            case LayerTypeMeta:
+            case LayerTypePriorBox:
+            case LayerTypePriorBoxClustered:
+                return true;
+            case LayerTypeConcat:
+                return param.concat().fixed();
+            case LayerTypeBroadcast:
+                return param.broadcast().fixed();
+            default:
+                return false;
+            }
+        }
+
+        void AddLifetime(Lifetimes & lifetimes, Tensor * tensor, size_t stage, bool fixed)
+        {
+            const uint8_t * data = tensor->RawCpuData();
+            if (data == NULL || tensor->RawSize() == 0)
+                return;
+            bool activation = tensor->GetType() == TensorType32f || tensor->GetType() == TensorType8u || tensor->GetType() == TensorType8i;
+            typename Lifetimes::iterator it = lifetimes.find(data);
+            if (it == lifetimes.end())
+            {
+                Lifetime & lifetime = lifetimes[data];
+                lifetime.begin = stage;
+                lifetime.end = stage;
+                lifetime.size = tensor->RawSize();
+                lifetime.owner = tensor->MemoryUsage() != 0;
+                lifetime.fixed = fixed || !activation;
+                lifetime.tensors.push_back(tensor);
+            }
+            else
+            {
+                Lifetime & lifetime = it->second;
+                lifetime.begin = std::min(lifetime.begin, stage);
+                lifetime.end = std::max(lifetime.end, stage);
+                lifetime.size = std::max(lifetime.size, tensor->RawSize());
+                lifetime.owner = lifetime.owner || tensor->MemoryUsage() != 0;
+                lifetime.fixed = lifetime.fixed || fixed || !activation;
+                if (std::find(lifetime.tensors.begin(), lifetime.tensors.end(), tensor) == lifetime.tensors.end())
+                    lifetime.tensors.push_back(tensor);
+            }
+        }
+
+        void PlanMemory()
+        {
+            if (!_context.options.memoryPlanning)
+                return;
+            Lifetimes lifetimes;
+            for (size_t i = 0; i < _input.size(); ++i)
+                for (size_t j = 0; j < _input[i].dst.size(); ++j)
+                    AddLifetime(lifetimes, _input[i].dst[j], 0, true);
+            for (size_t i = 0; i < _src.size(); ++i)
+                AddLifetime(lifetimes, _src[i], 0, true);
+            for (size_t i = 0; i < _dst.size(); ++i)
+                AddLifetime(lifetimes, _dst[i], _stages.size(), true);
+            for (size_t s = 0; s < _stages.size(); ++s)
+            {
+                const Stage & stage = _stages[s];
+                bool fixed = IsConst(*stage.layer);
+                for (size_t j = 0; j < stage.src.size(); ++j)
+                    AddLifetime(lifetimes, stage.src[j], s, false);
+                for (size_t j = 0; j < stage.dst.size(); ++j)
+                    AddLifetime(lifetimes, stage.dst[j], s, fixed);
+            }
+
+            // Concat inputs are placed into the output only if they are contiguous slices of it
+            // (ConcatLayer::CanInPlace: a single outer block, so NCHW channel concat works for batch 1 only)
+            // and their sizes add up exactly to the output size. Otherwise the concat copies as usual.
+            Slices slices;
+            for (size_t s = 0; s < _stages.size(); ++s)
+                PlanConcat(lifetimes, s, slices);
+
+            _planner.Clear();
+            std::vector<const Lifetime*> planned;
+            std::map<const uint8_t*, size_t> index;
+            for (typename Lifetimes::const_iterator it = lifetimes.begin(); it != lifetimes.end(); ++it)
+            {
+                const Lifetime & lifetime = it->second;
+                if (lifetime.fixed || !lifetime.owner || slices.find(it->first) != slices.end())
+                    continue;
+                _planner.Add(lifetime.size, lifetime.begin, lifetime.end);
+                index[it->first] = planned.size();
+                planned.push_back(&lifetime);
+            }
+            _arena.Resize(_planner.Plan());
+            _planned.clear();
+            for (size_t i = 0; i < planned.size(); ++i)
+            {
+                for (size_t j = 0; j < planned[i]->tensors.size(); ++j)
+                {
+                    planned[i]->tensors[j]->Place(_arena.data + _planner.Offset(i));
+                    _planned.push_back(planned[i]->tensors[j]);
+                }
+            }
+            for (typename Slices::const_iterator it = slices.begin(); it != slices.end(); ++it)
+            {
+                const Lifetime & lifetime = lifetimes[it->first];
+                uint8_t * data = _arena.data + _planner.Offset(index[it->second.parent]) + it->second.offset;
+                for (size_t j = 0; j < lifetime.tensors.size(); ++j)
+                {
+                    lifetime.tensors[j]->Place(data);
+                    _planned.push_back(lifetime.tensors[j]);
+                }
+            }
+        }
+
+        void PlanConcat(Lifetimes & lifetimes, size_t s, Slices & slices)
+        {
+            const Stage & stage = _stages[s];
+            ConcatLayer<T> * concat = dynamic_cast<ConcatLayer<T>*>(stage.layer);
+            if (concat == NULL || !concat->CanInPlace())
+                return;
+            const uint8_t * parent = stage.dst[0]->RawCpuData();
+            typename Lifetimes::iterator dst = lifetimes.find(parent);
+            if (dst == lifetimes.end() || dst->second.fixed || !dst->second.owner || slices.find(parent) != slices.end())
+                return;
+            std::vector<const uint8_t*> datas;
+            size_t total = 0;
+            for (size_t i = 0; i < stage.src.size(); ++i)
+            {
+                const uint8_t * data = stage.src[i]->RawCpuData();
+                typename Lifetimes::const_iterator src = lifetimes.find(data);
+                if (src == lifetimes.end() || src->second.fixed || !src->second.owner || src->second.end != s ||
+                    src->second.size != stage.src[i]->RawSize() || stage.src[i]->GetType() != stage.dst[0]->GetType())
+                    return;
+                if (std::find(datas.begin(), datas.end(), data) != datas.end())
+                    return;
+                for (typename Slices::const_iterator it = slices.begin(); it != slices.end(); ++it)
+                    if (it->second.parent == data)
+                        return;
+                datas.push_back(data);
+                total += stage.src[i]->RawSize();
+            }
+            if (total != stage.dst[0]->RawSize())
+                return;
+            size_t offset = 0;
+            for (size_t i = 0; i < stage.src.size(); ++i)
+            {
+                slices[datas[i]] = Slice(parent, offset);
+                dst->second.begin = std::min(dst->second.begin, lifetimes[datas[i]].begin);
+                offset += stage.src[i]->RawSize();
+            }
+            concat->SetInPlace(true);
+        }
+
+        void ReleaseMemory()
+        {
+            for (size_t i = 0; i < _planned.size(); ++i)
+                _planned[i]->Clear(true);
+            _planned.clear();
+            _planner.Clear();
+            _arena.Resize(0);
+        }
+
+        typedef std::pair<const uint8_t*, const uint8_t*> Range;
+        typedef std::vector<Range> Ranges;
+
+        static void AddRanges(const TensorPtrs & tensors, Ranges & ranges)
+        {
+            for (size_t i = 0; i < tensors.size(); ++i)
+            {
+                const uint8_t * data = tensors[i]->RawCpuData();
+                if (data && tensors[i]->RawSize())
+                    ranges.push_back(Range(data, data + tensors[i]->RawSize()));
+            }
+        }
+
+        static bool Intersect(const Ranges & a, const Ranges & b)
+        {
+            for (size_t i = 0; i < a.size(); ++i)
+                for (size_t j = 0; j < b.size(); ++j)
+                    if (a[i].first < b[j].second && b[j].first < a[i].second)
+                        return true;
+            return false;
+        }
+
+        static void ExtendAs(Tensor & dst, const Tensor & src)
+        {
+            if (src.RawSize() == 0)
+                return;
+            Shape shape = Shp(src.RawSize() / src.TypeSize());
+            switch (src.GetType())
+            {
+            case TensorType32f: dst.As32f().Extend(shape); break;
+            case TensorType32i: dst.As32i().Extend(shape); break;
+            case TensorType8i: dst.As8i().Extend(shape); break;
+            case TensorType8u: dst.As8u().Extend(shape); break;
+            default: break;
+            }
+        }
+
+        void InitExecutor()
+        {
+            size_t threads = _context.options.interOpThreads;
+            if (threads < 2 || _stages.size() < 2)
+            {
+                _executor.reset();
+                return;
+            }
+            if (!_executor)
+                _executor.reset(new GraphExecutor());
+            _executor->Init(threads);
+            _workBufs.resize(threads);
+            _workBufs[0] = _stages[0].buf;
+            for (size_t t = 1; t < threads; ++t)
+            {
+                if (_workBufs[t].empty())
+                    SetBuffers(_workBufs[t]);
+                for (size_t i = 0; i < _workBufs[t].size(); ++i)
+                    ExtendAs(*_workBufs[t][i], *_workBufs[0][i]);
+            }
+
+            std::vector<IdSet> prev(_stages.size());
+            for (NameIdSetMap::const_iterator src = _srcIds.begin(); src != _srcIds.end(); ++src)
+            {
+                NameIdSetMap::const_iterator dst = _dstIds.find(src->first);
+                if (dst == _dstIds.end())
+                    continue;
+                for (IdSet::const_iterator c = src->second.begin(); c != src->second.end(); ++c)
+                {
+                    IdSet::const_iterator p = dst->second.lower_bound(*c);
+                    if (p != dst->second.begin())
+                        prev[*c].insert(*--p);
+                }
+            }
+            std::vector<Ranges> reads(_stages.size()), writes(_stages.size());
+            for (size_t s = 0; s < _stages.size(); ++s)
+            {
+                AddRanges(_stages[s].src, reads[s]);
+                AddRanges(_stages[s].dst, writes[s]);
+                for (size_t p = 0; p < s; ++p)
+                    if (Intersect(writes[p], reads[s]) || Intersect(writes[p], writes[s]) || Intersect(reads[p], writes[s]))
+                        prev[s].insert(p);
+            }
+            std::vector<GraphExecutor::Nodes> next(_stages.size());
+            for (size_t s = 0; s < _stages.size(); ++s)
+                for (IdSet::const_iterator p = prev[s].begin(); p != prev[s].end(); ++p)
+                    next[*p].push_back(s);
+            _executor->SetGraph(next);
+        }
+
+        static size_t Bytes(const Stage & stage)
+        {
+            size_t bytes = 0;
+            for (size_t i = 0; i < stage.src.size(); ++i)
+                bytes += stage.src[i]->RawSize();
+            for (size_t i = 0; i < stage.dst.size(); ++i)
+                bytes += stage.dst[i]->RawSize();
+            for (size_t i = 0; i < stage.layer->Weight().size(); ++i)
+                bytes += stage.layer->Weight()[i].RawSize();
+            return bytes;
+        }
+
+        Strings DstNames() const
+        {
+            Strings names;
+            for (size_t i = 0; i < _dst.size(); ++i)
+            {
+                for (size_t j = 0; j < _stages.size(); ++j)
+                {
+                    if (_stages[j].dst.size() && _stages[j].dst[0] == _dst[i])
+                    {
+                        names.push_back(_stages[j].layer->Param().name());
+                        break;
+                    }
+                }
+            }
+            return names;
+        }
+
+        void SwapPlan(Plan & plan)
+        {
+            std::swap(_key, plan.key);
+            _layers.swap(plan.layers);
+            _tensors.swap(plan.tensors);
+            _stats.swap(plan.stats);
+            _input.swap(plan.input);
+            _stages.swap(plan.stages);
+            _src.swap(plan.src);
+            _dst.swap(plan.dst);
+            _back.swap(plan.back);
+            _tensorId.swap(plan.tensorId);
+            _layerId.swap(plan.layerId);
+            _statId.swap(plan.statId);
+            _srcIds.swap(plan.srcIds);
+            _dstIds.swap(plan.dstIds);
+            std::swap(_planner, plan.planner);
+            _arena.Swap(plan.arena);
+            _planned.swap(plan.planned);
+            _workBufs.swap(plan.workBufs);
+        }
+
+        bool RestorePlan(const PlanKey & key)
+        {
+            if (key == _key)
+                return true;
+            typename Plans::iterator it = _plans.begin();
+            while (it != _plans.end() && !(it->key == key))
+                ++it;
+            if (it == _plans.end() && (_compact || _key.srcNames.empty()))
+                return false;
+
+            if (_key.srcNames.size())
+            {
+                _plans.emplace_front();
+                SwapPlan(_plans.front());
+            }
+            if (it != _plans.end())
+            {
+                SwapPlan(*it);
+                _plans.erase(it);
+                InitExecutor();
+            }
+            else
+            {
+                const LayerSharedPtrs & layers = _plans.front().layers;
+                CreateLayers();
+                for (size_t i = 0; i < _layers.size(); ++i)
+                    _layers[i]->Share(*layers[i]);
+                Init(false);
+            }
+            while (_plans.size() > _context.options.reshapeCacheSize)
+                _plans.pop_back();
+            return _key == key;
         }
 
         void SetBuffers(TensorPtrs & buf)
@@ -28,6 +28,7 @@
 #include "Synet/Common.h"
 #include "Synet/Utils/Xml.h"
 #include "Synet/Utils/StringUtils.h"
+#include "Synet/Utils/BinaryUtils.h"
 
 namespace Synet
 {
@@ -119,6 +120,68 @@ namespace Synet
             return result;
         }
 
+        bool SaveBinary(std::ostream & os, const char * weight = NULL, size_t size = 0) const
+        {
+            std::stringstream params;
+            this->WriteBinary(params);
+            String data = params.str();
+            BinaryHeader header;
+            header.magic = BINARY_MAGIC;
+            header.version = BINARY_VERSION;
+            header.signature = this->Signature();
+            header.reserved = 0;
+            header.paramSize = data.size();
+            header.weightOffset = (sizeof(BinaryHeader) + data.size() + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN;
+            header.weightSize = size;
+            BinaryWrite(os, header);
+            os.write(data.data(), data.size());
+            String pad(header.weightOffset - sizeof(BinaryHeader) - data.size(), 0);
+            os.write(pad.data(), pad.size());
+            if (size)
+                os.write(weight, size);
+            return (bool)os;
+        }
+
+        bool SaveBinary(const String & path, const char * weight = NULL, size_t size = 0) const
+        {
+            bool result = false;
+            std::ofstream ofs(path.c_str(), std::ofstream::binary);
+            if (ofs.is_open())
+            {
+                result = this->SaveBinary(ofs, weight, size);
+                ofs.close();
+            }
+            return result;
+        }
+
+        bool LoadBinary(const char * data, size_t size, const char ** weight = NULL, size_t * weightSize = NULL)
+        {
+            BinaryHeader header;
+            if (!IsBinary(data, size))
+                return false;
+            memcpy(&header, data, sizeof(BinaryHeader));
+            if (header.version != BINARY_VERSION || header.signature != this->Signature())
+            {
+                std::cout << "Binary model was saved with other version of Synet parameters!" << std::endl;
+                return false;
+            }
+            if (sizeof(BinaryHeader) + header.paramSize > size || header.weightOffset + header.weightSize > size)
+                return false;
+            const char * params = data + sizeof(BinaryHeader);
+            if (!this->ReadBinary(params, params + header.paramSize))
+                return false;
+            if (weight)
+                *weight = data + header.weightOffset;
+            if (weightSize)
+                *weightSize = (size_t)header.weightSize;
+            return true;
+        }
+
+        static bool IsBinary(const char * data, size_t size)
+        {
+            return size >= sizeof(BinaryHeader) && ((const BinaryHeader*)data)->magic == BINARY_MAGIC;
+        }
+
     protected:
         enum Mode
         {
@@ -149,6 +212,20 @@ namespace Synet
 
         typedef Param<int> Unknown;
 
+        static const uint32_t BINARY_MAGIC = 0x424E5953;
+        static const uint32_t BINARY_VERSION = 1;
+        static const size_t BINARY_ALIGN = 64;
+
+        struct BinaryHeader
+        {
+            uint32_t magic, version, signature, reserved;
+            uint64_t paramSize, weightOffset, weightSize;
+        };
+
+        virtual void ToBinary(std::ostream & os) const {}
+        virtual bool FromBinary(const char *& data, const char * end) { return false; }
+        virtual void ItemSignature(uint32_t & hash) const {}
+
         SYNET_INLINE Unknown * StructBegin() const { return (Unknown*)(&_value); }
         SYNET_INLINE Unknown * StructNext(const Unknown * param) const { return (Unknown*)((char*)param + param->_size); }
         SYNET_INLINE Unknown * StructEnd() const { return (Unknown *)((char*)this + this->_size); }
@@ -210,6 +287,124 @@ namespace Synet
             return true;
         }
 
+        void WriteBinary(std::ostream & os) const
+        {
+            switch (_mode)
+            {
+            case Value:
+                this->ToBinary(os);
+                break;
+            case Struct:
+                WriteBinary(os, this->StructBegin(), this->StructEnd());
+                break;
+            case Vector:
+            {
+                uint32_t size = 0;
+                for (const Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                    size++;
+                BinaryWrite(os, size);
+                for (const Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                    WriteBinary(os, paramItem, this->VectorNext(paramItem));
+                break;
+            }
+            }
+        }
+
+        static void WriteBinary(std::ostream & os, const Unknown * begin, const Unknown * end)
+        {
+            uint16_t count = 0, index = 0;
+            for (const Unknown * paramChild = begin; paramChild < end; paramChild = begin->StructNext(paramChild))
+                count += paramChild->Changed() ? 1 : 0;
+            BinaryWrite(os, count);
+            for (const Unknown * paramChild = begin; paramChild < end; paramChild = begin->StructNext(paramChild), ++index)
+            {
+                if (paramChild->Changed())
+                {
+                    BinaryWrite(os, index);
+                    paramChild->WriteBinary(os);
+                }
+            }
+        }
+
+        bool ReadBinary(const char *& data, const char * end)
+        {
+            switch (_mode)
+            {
+            case Value:
+                return this->FromBinary(data, end);
+            case Struct:
+                return ReadBinary(data, end, this->StructBegin(), this->StructEnd());
+            case Vector:
+            {
+                uint32_t size;
+                if (!BinaryRead(data, end, size) || size > size_t(end - data))
+                    return false;
+                this->Resize(size);
+                for (Unknown * paramItem = this->VectorBegin(); paramItem < this->VectorEnd(); paramItem = this->VectorNext(paramItem))
+                    if (!ReadBinary(data, end, paramItem, this->VectorNext(paramItem)))
+                        return false;
+                return true;
+            }
+            }
+            return false;
+        }
+
+        static bool ReadBinary(const char *& data, const char * end, Unknown * begin, Unknown * stop)
+        {
+            uint16_t count, index, current = 0;
+            if (!BinaryRead(data, end, count))
+                return false;
+            Unknown * paramChild = begin;
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                if (!BinaryRead(data, end, index) || index < current)
+                    return false;
+                for (; current < index && paramChild < stop; ++current)
+                    paramChild = begin->StructNext(paramChild);
+                if (paramChild >= stop || !paramChild->ReadBinary(data, end))
+                    return false;
+            }
+            return true;
+        }
+
+        uint32_t Signature() const
+        {
+            uint32_t hash = 2166136261u;
+            Signature(hash, (uint32_t)sizeof(size_t));
+            this->Signature(hash);
+            return hash;
+        }
+
+        void Signature(uint32_t & hash) const
+        {
+            for (size_t i = 0; i < _name.size(); ++i)
+                Signature(hash, (uint32_t)_name[i]);
+            Signature(hash, (uint32_t)_mode);
+            Signature(hash, (uint32_t)_size);
+            switch (_mode)
+            {
+            case Value:
+                break;
+            case Struct:
+                Signature(hash, this->StructBegin(), this->StructEnd());
+                break;
+            case Vector:
+                this->ItemSignature(hash);
+                break;
+            }
+        }
+
+        static void Signature(uint32_t & hash, const Unknown * begin, const Unknown * end)
+        {
+            for (const Unknown * paramChild = begin; paramChild < end; paramChild = begin->StructNext(paramChild))
+                paramChild->Signature(hash);
+        }
+
+        static SYNET_INLINE void Signature(uint32_t & hash, uint32_t value)
+        {
+            hash = (hash ^ value) * 16777619u;
+        }
+
         void Save(Xml::XmlDocument<char> & xmlDoc, Xml::XmlNode<char> * xmlParent, bool full) const
         {
             Xml::XmlNode<char> * xmlCurrent = xmlDoc.AllocateNode(Xml::NodeElement, xmlDoc.AllocateString(this->Name().c_str()));
@@ -271,6 +466,8 @@ virtual Synet::String ToString() const { using namespace Synet; return ValueToSt
 virtual void ToValue(const Synet::String & string) { using namespace Synet; StringToValue(string, this->_value); } \
 virtual bool Changed() const { return this->Default() != this->_value; } \
 virtual void Clone(const Param_##name & other) { this->_value = other._value; } \
+virtual void ToBinary(std::ostream & os) const { using namespace Synet; BinaryWrite(os, this->_value); } \
+virtual bool FromBinary(const char *& data, const char * end) { using namespace Synet; return BinaryRead(data, end, this->_value); } \
 } name;
 
 #define SYNET_PARAM_STRUCT(type, name) \
@@ -287,6 +484,7 @@ typedef Synet::Param<std::vector<type>> Base; \
 Param_##name() : Base(Base::Vector, #name, sizeof(Param_##name), sizeof(type)) {} \
 virtual void Resize(size_t size) { this->_value.resize(size); } \
 virtual bool Changed() const { return !this->_value.empty(); } \
+virtual void ItemSignature(uint32_t & hash) const { type item; Base::Signature(hash, (const typename Base::Unknown*)&item, (const typename Base::Unknown*)((char*)&item + sizeof(type))); } \
 } name;
 
 #define SYNET_PARAM_ENUM_(type, unknown, size, ...) \
@@ -43,6 +43,7 @@ namespace Synet
         LayerTypeDeconvolution,
         LayerTypeDetectionOutput,
         LayerTypeDropout,
+        LayerTypeElementwise,
         LayerTypeEltwise,
         LayerTypeElu,
         LayerTypeExpandDims,
@@ -109,6 +110,31 @@ namespace Synet
         BinaryOperationTypeDiv,
         BinaryOperationTypeSub);
 
+    SYNET_PARAM_ENUM(ElementwiseOpType,
+        ElementwiseOpTypeAdd,
+        ElementwiseOpTypeSub,
+        ElementwiseOpTypeMul,
+        ElementwiseOpTypeDiv,
+        ElementwiseOpTypeMax,
+        ElementwiseOpTypeMin,
+        ElementwiseOpTypePrelu,
+        ElementwiseOpTypeRelu,
+        ElementwiseOpTypeSigmoid,
+        ElementwiseOpTypeElu,
+        ElementwiseOpTypeHswish,
+        ElementwiseOpTypeMish,
+        ElementwiseOpTypeSoftplus,
+        ElementwiseOpTypeRestrictRange,
+        ElementwiseOpTypePower,
+        ElementwiseOpTypeAbs,
+        ElementwiseOpTypeExp,
+        ElementwiseOpTypeLog,
+        ElementwiseOpTypeNeg,
+        ElementwiseOpTypeRsqrt,
+        ElementwiseOpTypeSqrt,
+        ElementwiseOpTypeTanh,
+        ElementwiseOpTypeZero);
+
     SYNET_PARAM_ENUM(EltwiseOperationType,
         EltwiseOperationTypeProduct,
         EltwiseOperationTypeSum,
@@ -185,6 +211,12 @@ namespace Synet
         QuantizationMethodSymmetricNarrowed,
         QuantizationMethodUnifiedNarrowed);
 
+    SYNET_PARAM_ENUM(CalibrationMethod,
+        CalibrationMethodQuantile,
+        CalibrationMethodPercentile,
+        CalibrationMethodEntropy,
+        CalibrationMethodMse);
+
     SYNET_PARAM_ENUM(TensorFormat,
         TensorFormatNchw,
         TensorFormatNhwc,
@@ -322,6 +354,19 @@ namespace Synet
         SYNET_PARAM_VALUE(int32_t, axis, 0);
     };
 
+    struct ElementwiseOpParam
+    {
+        SYNET_PARAM_VALUE(ElementwiseOpType, type, ElementwiseOpTypeUnknown);
+        SYNET_PARAM_VALUE(Ints, src, Ints());
+        SYNET_PARAM_VALUE(uint32_t, axis, 1);
+        SYNET_PARAM_VALUE(Floats, floats, Floats());
+    };
+
+    struct ElementwiseParam
+    {
+        SYNET_PARAM_VECTOR(ElementwiseOpParam, op);
+    };
+
     struct EltwiseParam
     {
         SYNET_PARAM_VALUE(EltwiseOperationType, operation, EltwiseOperationTypeSum);
@@ -645,6 +690,7 @@ namespace Synet
         SYNET_PARAM_STRUCT(ConcatParam, concat);
         SYNET_PARAM_STRUCT(ConvolutionParam, convolution);
         SYNET_PARAM_STRUCT(DetectionOutputParam, detectionOutput);
+        SYNET_PARAM_STRUCT(ElementwiseParam, elementwise);
         SYNET_PARAM_STRUCT(EltwiseParam, eltwise);
         SYNET_PARAM_STRUCT(EluParam, elu);
         SYNET_PARAM_STRUCT(ExpandDimsParam, expandDims);
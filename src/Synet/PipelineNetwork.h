@@ -0,0 +1,198 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Network.h"
+
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+namespace Synet
+{
+    template <class T> class PipelineNetwork
+    {
+    public:
+        typedef Synet::Network<T> Network;
+        typedef std::function<void(size_t index, Network & network)> Input;
+        typedef std::function<void(size_t index, const Network & network)> Output;
+
+        PipelineNetwork()
+        {
+        }
+
+        bool Init(const Network & network, size_t segments, bool measure = false)
+        {
+            _contexts.clear();
+            _bounds.clear();
+            if (segments == 0 || network.Empty())
+                return false;
+            segments = std::min(segments, network.StageCount());
+            _contexts.resize(segments);
+            for (size_t i = 0; i < segments; ++i)
+            {
+                _contexts[i].reset(new Network());
+                if (!network.Clone(*_contexts[i]))
+                {
+                    _contexts.clear();
+                    return false;
+                }
+            }
+            std::vector<double> costs = measure ? Measure(*_contexts[0]) : Flops(*_contexts[0]);
+            Balance(costs, segments);
+            return true;
+        }
+
+        size_t Segments() const
+        {
+            return _contexts.size();
+        }
+
+        size_t SegmentBegin(size_t segment) const
+        {
+            return _bounds[segment];
+        }
+
+        size_t SegmentEnd(size_t segment) const
+        {
+            return _bounds[segment + 1];
+        }
+
+        Network & Context(size_t index)
+        {
+            return *_contexts[index % _contexts.size()];
+        }
+
+        void Forward(size_t count, const Input & input, const Output & output)
+        {
+            const size_t segments = _contexts.size();
+            if (segments == 0)
+                return;
+            _progress.assign(segments, 0);
+            std::vector<std::thread> threads;
+            for (size_t s = 1; s < segments; ++s)
+                threads.push_back(std::thread(&PipelineNetwork::Run, this, s, count, std::cref(input), std::cref(output)));
+            Run(0, count, input, output);
+            for (size_t s = 0; s < threads.size(); ++s)
+                threads[s].join();
+        }
+
+    private:
+        typedef std::shared_ptr<Network> NetworkPtr;
+        typedef std::vector<NetworkPtr> NetworkPtrs;
+
+        NetworkPtrs _contexts;
+        std::vector<size_t> _bounds, _progress;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+
+        void Run(size_t segment, size_t count, const Input & input, const Output & output)
+        {
+            const size_t segments = _contexts.size();
+            for (size_t n = 0; n < count; ++n)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    if (segment)
+                        _cond.wait(lock, [&] { return _progress[segment - 1] > n; });
+                    else if (n >= segments)
+                        _cond.wait(lock, [&] { return _progress[segments - 1] > n - segments; });
+                }
+                Network & network = Context(n);
+                if (segment == 0)
+                    input(n, network);
+                network.Forward(_bounds[segment], _bounds[segment + 1]);
+                if (segment == segments - 1)
+                    output(n, network);
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _progress[segment] = n + 1;
+                }
+                _cond.notify_all();
+            }
+        }
+
+        static std::vector<double> Flops(const Network & network)
+        {
+            std::vector<double> costs(network.StageCount());
+            for (size_t i = 0; i < costs.size(); ++i)
+                costs[i] = std::max<double>(double(network.StageLayer(i)->Flop()), 1.0);
+            return costs;
+        }
+
+        static std::vector<double> Measure(Network & network)
+        {
+            typedef std::chrono::high_resolution_clock Clock;
+            std::vector<double> costs(network.StageCount());
+            network.Forward(0, costs.size());
+            for (size_t i = 0; i < costs.size(); ++i)
+            {
+                Clock::time_point start = Clock::now();
+                network.Forward(i, i + 1);
+                costs[i] = std::chrono::duration<double>(Clock::now() - start).count();
+            }
+            return costs;
+        }
+
+        void Balance(const std::vector<double> & costs, size_t segments)
+        {
+            double total = 0, lower = 0;
+            for (size_t i = 0; i < costs.size(); ++i)
+                total += costs[i], lower = std::max(lower, costs[i]);
+            double upper = total;
+            for (int iter = 0; iter < 64 && upper - lower > total * 0.0001; ++iter)
+            {
+                double limit = (lower + upper) / 2;
+                if (Split(costs, limit) <= segments)
+                    upper = limit;
+                else
+                    lower = limit;
+            }
+            Split(costs, upper);
+            while (_bounds.size() < segments + 1)
+                _bounds.insert(_bounds.end() - 1, _bounds[_bounds.size() - 2]);
+        }
+
+        size_t Split(const std::vector<double> & costs, double limit)
+        {
+            _bounds.assign(1, 0);
+            double sum = 0;
+            for (size_t i = 0; i < costs.size(); ++i)
+            {
+                if (sum + costs[i] > limit && sum > 0)
+                {
+                    _bounds.push_back(i);
+                    sum = 0;
+                }
+                sum += costs[i];
+            }
+            _bounds.push_back(costs.size());
+            return _bounds.size() - 1;
+        }
+    };
+}
@@ -65,6 +65,7 @@ namespace Synet
 
     template<class T> SYNET_INLINE T Overlap(const Region<T>& a, const Region<T>& b)
     {
-        return Intersection(a, b) / Union(a, b);
+        T i = Intersection(a, b);
+        return i / (a.w * a.h + b.w * b.h - i);
     }
 }
\ No newline at end of file
@@ -25,4 +25,6 @@
 #pragma once
 
 #include "Synet/Network.h"
-#include "Synet/Utils/Difference.h"
\ No newline at end of file
+#include "Synet/Utils/Difference.h"
+#include "Synet/PipelineNetwork.h"
+#include "Synet/BatchingExecutor.h"
\ No newline at end of file
@@ -427,6 +427,11 @@ namespace Synet
             assert(Size(0, _shape.size()) <= _buffer->size);
         }
 
+        SYNET_INLINE void Place(uint8_t * data)
+        {
+            _buffer->Share((Type*)data, _buffer->size);
+        }
+
         SYNET_INLINE void Clone(const Tensor & tensor)
         {
             _type = tensor._type;
@@ -0,0 +1,82 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+namespace Synet
+{
+    template<class T> SYNET_INLINE void BinaryWrite(std::ostream& os, const T& value)
+    {
+        os.write((const char*)&value, sizeof(T));
+    }
+
+    SYNET_INLINE void BinaryWrite(std::ostream& os, const String& value)
+    {
+        uint32_t size = (uint32_t)value.size();
+        BinaryWrite(os, size);
+        os.write(value.data(), size);
+    }
+
+    template<class T> SYNET_INLINE void BinaryWrite(std::ostream& os, const std::vector<T>& values)
+    {
+        uint32_t size = (uint32_t)values.size();
+        BinaryWrite(os, size);
+        for (size_t i = 0; i < values.size(); ++i)
+            BinaryWrite(os, values[i]);
+    }
+
+    template<class T> SYNET_INLINE bool BinaryRead(const char*& data, const char* end, T& value)
+    {
+        if (data + sizeof(T) > end)
+            return false;
+        memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return true;
+    }
+
+    SYNET_INLINE bool BinaryRead(const char*& data, const char* end, String& value)
+    {
+        uint32_t size;
+        if (!BinaryRead(data, end, size) || data + size > end)
+            return false;
+        value.assign(data, size);
+        data += size;
+        return true;
+    }
+
+    template<class T> SYNET_INLINE bool BinaryRead(const char*& data, const char* end, std::vector<T>& values)
+    {
+        uint32_t size;
+        if (!BinaryRead(data, end, size) || size > size_t(end - data))
+            return false;
+        values.resize(size);
+        for (size_t i = 0; i < values.size(); ++i)
+            if (!BinaryRead(data, end, values[i]))
+                return false;
+        return true;
+    }
+}
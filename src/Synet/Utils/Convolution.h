@@ -25,52 +25,55 @@
 #pragma once
 
 #include "Synet/Utils/ConvParam.h"
+#include "Synet/Utils/SimdContext.h"
 
 namespace Synet
 {
     class Convolution32f
     {
     public:
+        typedef void(*Gemm32fNNPtr)(size_t M, size_t N, size_t K, const float* alpha, const float* A, size_t lda, const float* B, size_t ldb, const float* beta, float* C, size_t ldc);
+
         Convolution32f()
-            : _context(NULL)
-            , _batch(0)
+            : _batch(0)
             , _srcH(0)
             , _srcW(0)
+            , _gemm(NULL)
         {
         }
 
-        virtual ~Convolution32f()
-        {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context), _context = NULL;
-#endif
-        }
-
-        typedef void(*Gemm32fNNPtr)(size_t M, size_t N, size_t K, const float* alpha, const float* A, size_t lda, const float* B, size_t ldb, const float* beta, float* C, size_t ldc);
-
         SYNET_INLINE void Init(size_t batch, const ConvParam * conv, Gemm32fNNPtr gemm)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_batch != batch || _srcH != conv->srcH || _srcW != conv->srcW)
+            if (_batch != batch || _srcH != conv->srcH || _srcW != conv->srcW || _gemm != gemm)
             {
-                _batch = batch, _srcH = conv->srcH, _srcW = conv->srcW;
-                if (_context)
-                    ::SimdRelease(_context), _context = NULL;
-                _context = ::SimdSynetConvolution32fInit(batch, (const SimdConvolutionParameters*)conv, gemm);
+                _batch = batch, _srcH = conv->srcH, _srcW = conv->srcW, _gemm = gemm;
+                _context.Reset(::SimdSynetConvolution32fInit(batch, (const SimdConvolutionParameters*)conv, gemm));
             }
 #endif
         }
 
+        SYNET_INLINE void Release()
+        {
+            _context.Reset();
+            _batch = 0, _srcH = 0, _srcW = 0, _gemm = NULL;
+        }
+
         SYNET_INLINE bool Enable() const
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const Convolution32f & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch, _srcH = other._srcH, _srcW = other._srcW, _gemm = other._gemm;
         }
 
         SYNET_INLINE size_t ExternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution32fExternalBufferSize(_context) : 1;
+            return _context.Handle() ? ::SimdSynetConvolution32fExternalBufferSize(_context.Handle()) : 1;
 #else
             return 1;
 #endif
@@ -79,7 +82,7 @@ namespace Synet
         SYNET_INLINE size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution32fInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetConvolution32fInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -88,7 +91,7 @@ namespace Synet
         String Info() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution32fInfo(_context) : String();
+            return _context.Handle() ? ::SimdSynetConvolution32fInfo(_context.Handle()) : String();
 #else
             return String();
 #endif
@@ -97,22 +100,23 @@ namespace Synet
         SYNET_INLINE void SetParams(const float* weight, int* internal, const float* bias, const float* params)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetConvolution32fSetParams(_context, weight, (::SimdBool*)internal, bias, params);
+            if (_context.NeedParams())
+                ::SimdSynetConvolution32fSetParams(_context.Handle(), weight, (::SimdBool*)internal, bias, params);
 #endif
         }
 
         SYNET_INLINE void Forward(const float* src, float* buf, float* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-        if (_context)
-            ::SimdSynetConvolution32fForward(_context, src, buf, dst);
+        if (_context.Handle())
+            ::SimdSynetConvolution32fForward(_context.Handle(), src, buf, dst);
 #endif
         }
 
     private:
-        void * _context;
+        SimdContext _context;
         size_t _batch, _srcH, _srcW;
+        Gemm32fNNPtr _gemm;
     };
 
     //-------------------------------------------------------------------------
@@ -121,29 +125,19 @@ namespace Synet
     {
     public:
         Convolution8i()
-            : _context(NULL)
-            , _batch(0)
+            : _batch(0)
             , _srcH(0)
             , _srcW(0)
         {
         }
 
-        virtual ~Convolution8i()
-        {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context), _context = NULL;
-#endif
-        }
-
         SYNET_INLINE void Init(size_t batch, const ConvParam* conv, QuantizationMethod method)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
             if (_batch != batch || _srcH != conv->srcH || _srcW != conv->srcW)
             {
                 _batch = batch, _srcH = conv->srcH, _srcW = conv->srcW;
-                if (_context)
-                    ::SimdRelease(_context), _context = NULL;
+                _context.Reset();
                 SimdSynetCompatibilityType compatibility;
                 if (method == QuantizationMethodIECompatible)
                 {
@@ -156,20 +150,26 @@ namespace Synet
                 }
                 else
                     return;
-                _context = ::SimdSynetConvolution8iInit(batch, (const SimdConvolutionParameters*)conv, compatibility);
+                _context.Reset(::SimdSynetConvolution8iInit(batch, (const SimdConvolutionParameters*)conv, compatibility));
             }
 #endif
         }
 
         SYNET_INLINE bool Enable() const
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const Convolution8i & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch, _srcH = other._srcH, _srcW = other._srcW;
         }
 
         SYNET_INLINE size_t ExternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution8iExternalBufferSize(_context) : 1;
+            return _context.Handle() ? ::SimdSynetConvolution8iExternalBufferSize(_context.Handle()) : 1;
 #else
             return 1;
 #endif
@@ -178,7 +178,7 @@ namespace Synet
         SYNET_INLINE size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution8iInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetConvolution8iInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -187,7 +187,7 @@ namespace Synet
         String Info() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetConvolution8iInfo(_context) : String();
+            return _context.Handle() ? ::SimdSynetConvolution8iInfo(_context.Handle()) : String();
 #else
             return String();
 #endif
@@ -196,21 +196,21 @@ namespace Synet
         SYNET_INLINE void SetParams(const float* weight, const float* bias, const float* params, const float* const *stats)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetConvolution8iSetParams(_context, weight, bias, params, stats);
+            if (_context.NeedParams())
+                ::SimdSynetConvolution8iSetParams(_context.Handle(), weight, bias, params, stats);
 #endif
         }
 
         SYNET_INLINE void Forward(const uint8_t* src, uint8_t* buf, uint8_t* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetConvolution8iForward(_context, src, buf, dst);
+            if (_context.Handle())
+                ::SimdSynetConvolution8iForward(_context.Handle(), src, buf, dst);
 #endif
         }
 
     private:
-        void * _context;
+        SimdContext _context;
         size_t _batch, _srcH, _srcW;
     };
 }
\ No newline at end of file
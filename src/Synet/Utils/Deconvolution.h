@@ -25,24 +25,120 @@
 #pragma once
 
 #include "Synet/Utils/ConvParam.h"
+#include "Synet/Utils/SimdContext.h"
 
 namespace Synet
 {
-    class Deconvolution32f
+    namespace Detail
     {
-    public:
-        Deconvolution32f()
-            : _context(NULL)
-            , _batch(0)
+        SYNET_INLINE bool DeconvolutionSrcIndex(size_t dst, size_t kernel, size_t pad, size_t stride, size_t dilation, size_t size, size_t & src)
         {
+            ptrdiff_t idx = ptrdiff_t(dst + pad) - ptrdiff_t(kernel * dilation);
+            if (idx < 0 || idx % stride)
+                return false;
+            src = idx / stride;
+            return src < size;
         }
+    }
 
-        virtual ~Deconvolution32f()
+    SYNET_INLINE size_t DeconvolutionDirectBufferSize(const ConvParam& conv)
+    {
+        if (conv.Trans())
+            return conv.dstW * conv.dstC;
+        else
+            return conv.dstW + (DivHi(conv.dstW, conv.strideX) + 1) * conv.strideX;
+    }
+
+    template<class TS, class TW, class TD, class Epilogue> void DeconvolutionDirectNhwc(const TS* src, const ConvParam& conv,
+        const TW* weight, const TS* zero, TD* sum, Epilogue& epilogue)
+    {
+        assert(conv.group == 1);
+        size_t K = conv.kernelY * conv.kernelX * conv.dstC;
+        for (size_t dy = 0; dy < conv.dstH; ++dy)
+        {
+            memset(sum, 0, conv.dstW * conv.dstC * sizeof(TD));
+            for (size_t ky = 0, sy; ky < conv.kernelY; ++ky)
+            {
+                if (!Detail::DeconvolutionSrcIndex(dy, ky, conv.padY, conv.strideY, conv.dilationY, conv.srcH, sy))
+                    continue;
+                for (size_t dx = 0; dx < conv.dstW; ++dx)
+                {
+                    TD* pSum = sum + dx * conv.dstC;
+                    for (size_t kx = 0, sx; kx < conv.kernelX; ++kx)
+                    {
+                        if (!Detail::DeconvolutionSrcIndex(dx, kx, conv.padX, conv.strideX, conv.dilationX, conv.srcW, sx))
+                            continue;
+                        const TS* pSrc = src + (sy * conv.srcW + sx) * conv.srcC;
+                        const TW* pW = weight + (ky * conv.kernelX + kx) * conv.dstC;
+                        for (size_t sc = 0; sc < conv.srcC; ++sc, pW += K)
+                        {
+                            TD value = TD(pSrc[sc]) - (zero ? TD(zero[sc]) : TD(0));
+                            for (size_t dc = 0; dc < conv.dstC; ++dc)
+                                pSum[dc] += value * TD(pW[dc]);
+                        }
+                    }
+                }
+            }
+            epilogue(sum, dy * conv.dstW * conv.dstC, 0, conv.dstC, conv.dstW);
+        }
+    }
+
+    template<class TS, class TW, class TD, class Epilogue> void DeconvolutionDirectNchw(const TS* src, const ConvParam& conv,
+        const TW* weight, const TS* zero, TD* sum, Epilogue& epilogue)
+    {
+        size_t G = conv.group, C = conv.srcC / G, D = conv.dstC / G, S = conv.strideX;
+        size_t phaseW = DivHi(conv.dstW, S), pad = DivHi(conv.padX, S) * S;
+        TD* phase = sum + conv.dstW;
+        for (size_t g = 0; g < G; ++g)
+        {
+            for (size_t d = 0; d < D; ++d)
+            {
+                size_t dc = g * D + d;
+                for (size_t dy = 0; dy < conv.dstH; ++dy)
+                {
+                    memset(phase, 0, (phaseW + 1) * S * sizeof(TD));
+                    for (size_t ky = 0, sy; ky < conv.kernelY; ++ky)
+                    {
+                        if (!Detail::DeconvolutionSrcIndex(dy, ky, conv.padY, conv.strideY, conv.dilationY, conv.srcH, sy))
+                            continue;
+                        for (size_t c = 0; c < C; ++c)
+                        {
+                            size_t sc = g * C + c;
+                            const TS* pSrc = src + (sc * conv.srcH + sy) * conv.srcW;
+                            const TW* pW = weight + ((sc * D + d) * conv.kernelY + ky) * conv.kernelX;
+                            TD shift = zero ? TD(zero[sc]) : TD(0);
+                            for (size_t kx = 0; kx < conv.kernelX; ++kx)
+                            {
+                                ptrdiff_t beg = ptrdiff_t(kx * conv.dilationX) - ptrdiff_t(conv.padX);
+                                ptrdiff_t end = ptrdiff_t(conv.dstW) - beg;
+                                size_t sxBeg = beg < 0 ? (-beg + S - 1) / S : 0;
+                                size_t sxEnd = end > 0 ? Min<size_t>(conv.srcW, (end - 1) / S + 1) : 0;
+                                size_t offs = kx * conv.dilationX + pad - conv.padX;
+                                TD w = TD(pW[kx]);
+                                TD* pPhase = phase + (offs % S) * (phaseW + 1) + offs / S - pad / S;
+                                for (size_t sx = sxBeg; sx < sxEnd; ++sx)
+                                    pPhase[sx] += (TD(pSrc[sx]) - shift) * w;
+                            }
+                        }
+                    }
+                    for (size_t p = 0; p < S; ++p)
+                    {
+                        const TD* pPhase = phase + p * (phaseW + 1);
+                        for (size_t dx = p, j = 0; dx < conv.dstW; dx += S, ++j)
+                            sum[dx] = pPhase[j];
+                    }
+                    epilogue(sum, (dc * conv.dstH + dy) * conv.dstW, dc, 1, conv.dstW);
+                }
+            }
+        }
+    }
+
+    class Deconvolution32f
+    {
+    public:
+        Deconvolution32f()
+            : _batch(0)
         {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context);
-#endif
         }
 
         typedef void(*Gemm32fNNPtr)(size_t M, size_t N, size_t K, const float * alpha, const float* A, size_t lda, const float* B, size_t ldb, const float* beta, float* C, size_t ldc);
@@ -53,22 +149,26 @@ namespace Synet
             if (_batch != batch || _srcH != conv->srcH || _srcW != conv->srcW)
             {
                 _batch = batch, _srcH = conv->srcH, _srcW = conv->srcW;
-                if (_context)
-                    ::SimdRelease(_context);
-                _context = ::SimdSynetDeconvolution32fInit(batch, (const SimdConvolutionParameters*)conv, gemm);
+                _context.Reset(::SimdSynetDeconvolution32fInit(batch, (const SimdConvolutionParameters*)conv, gemm));
             }
 #endif
         }
 
         bool Enable()
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const Deconvolution32f & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch, _srcH = other._srcH, _srcW = other._srcW;
         }
 
         size_t ExternalBufferSize() const 
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetDeconvolution32fExternalBufferSize(_context) : 1;
+            return _context.Handle() ? ::SimdSynetDeconvolution32fExternalBufferSize(_context.Handle()) : 1;
 #else
             return 1;
 #endif
@@ -77,7 +177,7 @@ namespace Synet
         size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetDeconvolution32fInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetDeconvolution32fInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -86,7 +186,7 @@ namespace Synet
         String Info() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetDeconvolution32fInfo(_context) : String();
+            return _context.Handle() ? ::SimdSynetDeconvolution32fInfo(_context.Handle()) : String();
 #else
             return String();
 #endif
@@ -95,21 +195,21 @@ namespace Synet
         void SetParams(const float* weight, int * internal, const float * bias, const float * params)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetDeconvolution32fSetParams(_context, weight, (::SimdBool*)internal, bias, params);
+            if (_context.NeedParams())
+                ::SimdSynetDeconvolution32fSetParams(_context.Handle(), weight, (::SimdBool*)internal, bias, params);
 #endif
         }
 
         void Forward(const float* src, float* buf, float* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetDeconvolution32fForward(_context, src, buf, dst);
+            if (_context.Handle())
+                ::SimdSynetDeconvolution32fForward(_context.Handle(), src, buf, dst);
 #endif
         }
 
     private:
-        void * _context;
+        SimdContext _context;
         size_t _batch, _srcH, _srcW;
     };
 }
\ No newline at end of file
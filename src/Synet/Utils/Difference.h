@@ -115,7 +115,7 @@ namespace Synet
                     _height = _shape[2];
                     _width = _shape[3];
                 }
-                else if (TensorFormatNhwc)
+                else if (_format == TensorFormatNhwc)
                 {
                     _batch = _shape[0];
                     _height = _shape[1];
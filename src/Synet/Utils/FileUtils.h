@@ -26,6 +26,12 @@
 
 #include "Synet/Common.h"
 
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 namespace Synet
 {
     SYNET_INLINE bool FileExist(const String& path)
@@ -63,4 +69,84 @@ namespace Synet
         ofs.close();
         return result;
     }
+
+    class MappedFile
+    {
+    public:
+        MappedFile()
+            : _data(NULL)
+            , _size(0)
+        {
+        }
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        bool Open(const String& path)
+        {
+            Close();
+#ifdef _MSC_VER
+            if (!LoadBinaryData(path, _buffer))
+                return false;
+            _data = _buffer.data();
+            _size = _buffer.size();
+            return true;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+                return false;
+            struct stat info;
+            if (::fstat(fd, &info) == -1)
+            {
+                ::close(fd);
+                return false;
+            }
+            _size = (size_t)info.st_size;
+            if (_size)
+            {
+                void* data = ::mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    ::close(fd);
+                    _size = 0;
+                    return false;
+                }
+                _data = (char*)data;
+            }
+            ::close(fd);
+            return true;
+#endif
+        }
+
+        void Close()
+        {
+#ifdef _MSC_VER
+            _buffer.clear();
+#else
+            if (_data)
+                ::munmap(_data, _size);
+#endif
+            _data = NULL;
+            _size = 0;
+        }
+
+        const char* Data() const
+        {
+            return _data;
+        }
+
+        size_t Size() const
+        {
+            return _size;
+        }
+
+    private:
+        char* _data;
+        size_t _size;
+#ifdef _MSC_VER
+        std::vector<char> _buffer;
+#endif
+    };
 }
\ No newline at end of file
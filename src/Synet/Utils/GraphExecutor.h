@@ -0,0 +1,223 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace Synet
+{
+    class GraphExecutor
+    {
+    public:
+        typedef std::function<void(size_t node, size_t thread)> Task;
+        typedef std::vector<size_t> Nodes;
+
+        GraphExecutor()
+            : _size(0)
+            , _task(NULL)
+            , _run(0)
+            , _stop(false)
+        {
+            _done = 0;
+            _pending = 0;
+        }
+
+        ~GraphExecutor()
+        {
+            Stop();
+        }
+
+        void Init(size_t threads)
+        {
+            threads = std::max<size_t>(threads, 1);
+            if (threads == Threads())
+                return;
+            Stop();
+            _queues.reset(new Queue[threads]);
+            for (size_t i = 1; i < threads; ++i)
+                _threads.push_back(std::thread(&GraphExecutor::Worker, this, i));
+        }
+
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _start.notify_all();
+            for (size_t i = 0; i < _threads.size(); ++i)
+                if (_threads[i].joinable())
+                    _threads[i].join();
+            _threads.clear();
+            _queues.reset();
+            _stop = false;
+        }
+
+        size_t Threads() const
+        {
+            return _queues ? _threads.size() + 1 : 0;
+        }
+
+        void SetGraph(const std::vector<Nodes> & next)
+        {
+            _size = next.size();
+            _next = next;
+            _deps.assign(_size, 0);
+            for (size_t i = 0; i < _size; ++i)
+                for (size_t j = 0; j < _next[i].size(); ++j)
+                    _deps[_next[i][j]]++;
+            _count.reset(new std::atomic<size_t>[_size]);
+        }
+
+        void Run(const Task & task)
+        {
+            assert(Threads() > 0);
+            _task = &task;
+            for (size_t i = 0; i < _size; ++i)
+                _count[i] = _deps[i];
+            _done = 0;
+            for (size_t i = 0, t = 0; i < _size; ++i)
+                if (_deps[i] == 0)
+                    Push(t++ % Threads(), i);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _run++;
+            }
+            _start.notify_all();
+            Work(0);
+            _task = NULL;
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<size_t> nodes;
+        };
+
+        size_t _size;
+        std::vector<Nodes> _next;
+        Nodes _deps;
+        std::unique_ptr<std::atomic<size_t>[]> _count;
+        std::atomic<size_t> _done, _pending;
+        const Task * _task;
+
+        std::unique_ptr<Queue[]> _queues;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _start, _ready;
+        size_t _run;
+        bool _stop;
+
+        void Push(size_t thread, size_t node)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_queues[thread].mutex);
+                _queues[thread].nodes.push_back(node);
+            }
+            _pending++;
+            _ready.notify_one();
+        }
+
+        bool Pop(size_t thread, size_t & node)
+        {
+            std::lock_guard<std::mutex> lock(_queues[thread].mutex);
+            if (_queues[thread].nodes.empty())
+                return false;
+            node = _queues[thread].nodes.back();
+            _queues[thread].nodes.pop_back();
+            _pending--;
+            return true;
+        }
+
+        bool Steal(size_t thread, size_t & node)
+        {
+            for (size_t i = 1, n = Threads(); i < n; ++i)
+            {
+                Queue & queue = _queues[(thread + i) % n];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.nodes.empty())
+                    continue;
+                node = queue.nodes.front();
+                queue.nodes.pop_front();
+                _pending--;
+                return true;
+            }
+            return false;
+        }
+
+        void Work(size_t thread)
+        {
+            size_t node;
+            while (_done < _size)
+            {
+                if (Pop(thread, node) || Steal(thread, node))
+                {
+                    (*_task)(node, thread);
+                    const Nodes & next = _next[node];
+                    for (size_t i = 0; i < next.size(); ++i)
+                        if (--_count[next[i]] == 0)
+                            Push(thread, next[i]);
+                    if (++_done == _size)
+                        _ready.notify_all();
+                }
+                else
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _ready.wait_for(lock, std::chrono::microseconds(100), [this] { return _pending > 0 || _done >= _size; });
+                }
+            }
+        }
+
+        void Worker(size_t thread)
+        {
+            size_t run;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                run = _run;
+            }
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _start.wait(lock, [&] { return _stop || _run != run; });
+                    if (_stop)
+                        return;
+                    run = _run;
+                }
+                Work(thread);
+            }
+        }
+    };
+}
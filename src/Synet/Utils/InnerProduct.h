@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Synet/Common.h"
+#include "Synet/Utils/SimdContext.h"
 
 namespace Synet
 {
@@ -32,41 +33,36 @@ namespace Synet
     {
     public:
         InnerProduct32f()
-            : _context(NULL)
-            , _batch(0)
+            : _batch(0)
         {
         }
 
-        virtual ~InnerProduct32f()
-        {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context), _context = NULL;
-#endif
-        }
-
         SYNET_INLINE void Init(size_t batch, size_t input, size_t output, int transpose)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
             if (_batch != batch)
             {
                 _batch = batch;
-                if (_context)
-                    ::SimdRelease(_context), _context = NULL;
-                _context = ::SimdSynetInnerProduct32fInit(batch, input, output, transpose ? SimdTrue : SimdFalse, SimdConvolutionActivationIdentity);
+                _context.Reset(::SimdSynetInnerProduct32fInit(batch, input, output, transpose ? SimdTrue : SimdFalse, SimdConvolutionActivationIdentity));
             }
 #endif
         }
 
         SYNET_INLINE bool Enable() const
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const InnerProduct32f & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch;
         }
 
         SYNET_INLINE size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetInnerProduct32fInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetInnerProduct32fInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -75,21 +71,21 @@ namespace Synet
         SYNET_INLINE void SetParams(const float* weight, int* internal, const float* bias, const float* params)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetInnerProduct32fSetParams(_context, weight, (::SimdBool*)internal, bias, params);
+            if (_context.NeedParams())
+                ::SimdSynetInnerProduct32fSetParams(_context.Handle(), weight, (::SimdBool*)internal, bias, params);
 #endif
         }
 
         SYNET_INLINE void Forward(const float* src, float* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-        if (_context)
-            ::SimdSynetInnerProduct32fForward(_context, src, dst);
+        if (_context.Handle())
+            ::SimdSynetInnerProduct32fForward(_context.Handle(), src, dst);
 #endif
         }
 
     private:
-        void * _context;
+        SimdContext _context;
         size_t _batch;
     };
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+#include "Synet/Utils/Math.h"
+
+namespace Synet
+{
+    class MemoryPlanner
+    {
+    public:
+        MemoryPlanner(size_t align = 64)
+            : _align(align)
+            , _size(0)
+        {
+        }
+
+        void Clear()
+        {
+            _blocks.clear();
+            _size = 0;
+        }
+
+        size_t Add(size_t size, size_t begin, size_t end)
+        {
+            assert(begin <= end);
+            Block block;
+            block.size = DivHi(size, _align) * _align;
+            block.begin = begin;
+            block.end = end;
+            block.offset = 0;
+            _blocks.push_back(block);
+            return _blocks.size() - 1;
+        }
+
+        size_t Plan()
+        {
+            std::vector<size_t> order(_blocks.size());
+            for (size_t i = 0; i < order.size(); ++i)
+                order[i] = i;
+            std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return _blocks[a].size > _blocks[b].size; });
+
+            _size = 0;
+            std::vector<const Block*> placed, alive;
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                Block & block = _blocks[order[i]];
+                alive.clear();
+                for (size_t j = 0; j < placed.size(); ++j)
+                    if (placed[j]->begin <= block.end && block.begin <= placed[j]->end)
+                        alive.push_back(placed[j]);
+                std::sort(alive.begin(), alive.end(), [](const Block* a, const Block* b) { return a->offset < b->offset; });
+
+                size_t best = SIZE_MAX, bestGap = SIZE_MAX, offset = 0;
+                for (size_t j = 0; j < alive.size(); ++j)
+                {
+                    if (alive[j]->offset >= offset + block.size)
+                    {
+                        size_t gap = alive[j]->offset - offset;
+                        if (gap < bestGap)
+                        {
+                            best = offset;
+                            bestGap = gap;
+                        }
+                    }
+                    offset = Max(offset, alive[j]->offset + alive[j]->size);
+                }
+                block.offset = best != SIZE_MAX ? best : offset;
+                _size = Max(_size, block.offset + block.size);
+                placed.push_back(&block);
+            }
+            return _size;
+        }
+
+        size_t Offset(size_t index) const
+        {
+            return _blocks[index].offset;
+        }
+
+        size_t Size() const
+        {
+            return _size;
+        }
+
+        size_t NaiveSize() const
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < _blocks.size(); ++i)
+                size += _blocks[i].size;
+            return size;
+        }
+
+    private:
+        struct Block
+        {
+            size_t size, begin, end, offset;
+        };
+        typedef std::vector<Block> Blocks;
+
+        Blocks _blocks;
+        size_t _align, _size;
+    };
+}
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Synet/Utils/ConvParam.h"
+#include "Synet/Utils/SimdContext.h"
 
 namespace Synet
 {
@@ -32,44 +33,40 @@ namespace Synet
     {
     public:
         MergedConvolution32f()
-            : _context(NULL)
-            , _batch(0)
+            : _batch(0)
             , _srcH(0)
             , _srcW(0)
         {
         }
 
-        virtual ~MergedConvolution32f()
-        {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context), _context = NULL;
-#endif
-        }
-
         void Init(size_t batch, const ConvParam * convs, size_t count, int add)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
             if (_batch != batch || _srcH != convs[0].srcH || _srcW != convs[0].srcW)
             {
                 _batch = batch, _srcH = convs[0].srcH, _srcW = convs[0].srcW;
-                if (_context)
-                    ::SimdRelease(_context), _context = NULL;
+                _context.Reset();
                 if (convs[1].dstH > 1 && convs[1].dstW > 1)
-                    _context = ::SimdSynetMergedConvolution32fInit(batch, (const SimdConvolutionParameters*)convs, count, (SimdBool)add);
+                    _context.Reset(::SimdSynetMergedConvolution32fInit(batch, (const SimdConvolutionParameters*)convs, count, (SimdBool)add));
             }
 #endif
         }
 
         bool Enable() const
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const MergedConvolution32f & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch, _srcH = other._srcH, _srcW = other._srcW;
         }
 
         size_t ExternalBufferSize() const 
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution32fExternalBufferSize(_context) : 1;
+            return _context.Handle() ? ::SimdSynetMergedConvolution32fExternalBufferSize(_context.Handle()) : 1;
 #else
             return 1;
 #endif
@@ -78,7 +75,7 @@ namespace Synet
         size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution32fInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetMergedConvolution32fInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -87,7 +84,7 @@ namespace Synet
         String Info() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution32fInfo(_context) : String();
+            return _context.Handle() ? ::SimdSynetMergedConvolution32fInfo(_context.Handle()) : String();
 #else
             return String();
 #endif
@@ -96,21 +93,21 @@ namespace Synet
         void SetParams(const float * const * weight, int * internal, const float* const * bias, const float* const * params)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetMergedConvolution32fSetParams(_context, weight, (::SimdBool*)internal, bias, params);
+            if (_context.NeedParams())
+                ::SimdSynetMergedConvolution32fSetParams(_context.Handle(), weight, (::SimdBool*)internal, bias, params);
 #endif
         }
 
         void Forward(const float* src, float* buf, float* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetMergedConvolution32fForward(_context, src, buf, dst);
+            if (_context.Handle())
+                ::SimdSynetMergedConvolution32fForward(_context.Handle(), src, buf, dst);
 #endif
         }
 
     private:
-        void * _context;
+        SimdContext _context;
         size_t _batch, _srcH, _srcW;
     };
 
@@ -120,29 +117,19 @@ namespace Synet
     {
     public:
         MergedConvolution8i()
-            : _context(NULL)
-            , _batch(0)
+            : _batch(0)
             , _srcH(0)
             , _srcW(0)
         {
         }
 
-        virtual ~MergedConvolution8i()
-        {
-#ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdRelease(_context), _context = NULL;
-#endif
-        }
-
         SYNET_INLINE void Init(size_t batch, const ConvParam* convs, size_t count, QuantizationMethod method)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
             if (_batch != batch || _srcH != convs[0].srcH || _srcW != convs[0].srcW)
             {
                 _batch = batch, _srcH = convs[0].srcH, _srcW = convs[0].srcW;
-                if (_context)
-                    ::SimdRelease(_context), _context = NULL;
+                _context.Reset();
                 SimdSynetCompatibilityType compatibility;
                 if (method == QuantizationMethodIECompatible)
                 {
@@ -155,20 +142,26 @@ namespace Synet
                 }
                 else
                     return;
-                _context = ::SimdSynetMergedConvolution8iInit(batch, (const SimdConvolutionParameters*)convs, count, compatibility);
+                _context.Reset(::SimdSynetMergedConvolution8iInit(batch, (const SimdConvolutionParameters*)convs, count, compatibility));
             }
 #endif
         }
 
         SYNET_INLINE bool Enable() const
         {
-            return _context != NULL;
+            return _context.Handle() != NULL;
+        }
+
+        SYNET_INLINE void Share(const MergedConvolution8i & other)
+        {
+            _context.Share(other._context);
+            _batch = other._batch, _srcH = other._srcH, _srcW = other._srcW;
         }
 
         SYNET_INLINE size_t ExternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution8iExternalBufferSize(_context) : 1;
+            return _context.Handle() ? ::SimdSynetMergedConvolution8iExternalBufferSize(_context.Handle()) : 1;
 #else
             return 1;
 #endif
@@ -177,7 +170,7 @@ namespace Synet
         SYNET_INLINE size_t InternalBufferSize() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution8iInternalBufferSize(_context) : 0;
+            return _context.Owner() && _context.Handle() ? ::SimdSynetMergedConvolution8iInternalBufferSize(_context.Handle()) : 0;
 #else
             return 0;
 #endif
@@ -186,7 +179,7 @@ namespace Synet
         String Info() const
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            return _context ? ::SimdSynetMergedConvolution8iInfo(_context) : String();
+            return _context.Handle() ? ::SimdSynetMergedConvolution8iInfo(_context.Handle()) : String();
 #else
             return String();
 #endif
@@ -195,21 +188,21 @@ namespace Synet
         SYNET_INLINE void SetParams(const float* const* weight, int* internal, const float* const* bias, const float* const* params, const float* const* stats)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetMergedConvolution8iSetParams(_context, weight, (::SimdBool*)internal, bias, params, stats);
+            if (_context.NeedParams())
+                ::SimdSynetMergedConvolution8iSetParams(_context.Handle(), weight, (::SimdBool*)internal, bias, params, stats);
 #endif
         }
 
         SYNET_INLINE void Forward(const uint8_t* src, uint8_t* buf, uint8_t* dst)
         {
 #ifdef SYNET_SIMD_LIBRARY_ENABLE
-            if (_context)
-                ::SimdSynetMergedConvolution8iForward(_context, src, buf, dst);
+            if (_context.Handle())
+                ::SimdSynetMergedConvolution8iForward(_context.Handle(), src, buf, dst);
 #endif
         }
 
     private:
-        void* _context;
+        SimdContext _context;
         size_t _batch, _srcH, _srcW;
     };
 }
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#include <chrono>
+#include <cfloat>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+namespace Synet
+{
+    class Profiler
+    {
+    public:
+        enum Counter
+        {
+            CounterCycles = 0,
+            CounterInstructions,
+            CounterCacheMisses,
+            CounterSize,
+        };
+
+        Profiler(size_t maxEvents = 1024 * 1024)
+            : _maxEvents(maxEvents)
+            , _counters(false)
+        {
+            for (size_t c = 0; c < CounterSize; ++c)
+                _fd[c] = -1;
+            _epoch = Clock::now();
+        }
+
+        ~Profiler()
+        {
+            Close();
+        }
+
+        bool Init(bool counters)
+        {
+            if (counters && !_counters)
+            {
+#if defined(__linux__)
+                _fd[CounterCycles] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+                _fd[CounterInstructions] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+                _fd[CounterCacheMisses] = Open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+                _counters = _fd[CounterCycles] >= 0 || _fd[CounterInstructions] >= 0 || _fd[CounterCacheMisses] >= 0;
+#endif
+            }
+            else if (!counters && _counters)
+                Close();
+            return _counters == counters;
+        }
+
+        void Clear()
+        {
+            _records.clear();
+            _events.clear();
+            _epoch = Clock::now();
+        }
+
+        void Start()
+        {
+            Read(_start);
+            _time = Clock::now();
+        }
+
+        void Stop(size_t index, const String & name, const String & type, int64_t flop, size_t bytes)
+        {
+            Clock::time_point time = Clock::now();
+            uint64_t counters[CounterSize];
+            Read(counters);
+            if (index >= _records.size())
+                _records.resize(index + 1);
+            Record & record = _records[index];
+            if (record.name != name)
+                record = Record(name, type);
+            double duration = std::chrono::duration<double>(time - _time).count();
+            record.count++;
+            record.time += duration;
+            record.min = std::min(record.min, duration);
+            record.max = std::max(record.max, duration);
+            record.flop = flop;
+            record.bytes = bytes;
+            for (size_t c = 0; c < CounterSize; ++c)
+                record.counters[c] += counters[c] - _start[c];
+            if (_events.size() < _maxEvents)
+            {
+                Event event;
+                event.index = index;
+                event.start = std::chrono::duration<double>(_time - _epoch).count();
+                event.duration = duration;
+                _events.push_back(event);
+            }
+        }
+
+        void WriteJson(std::ostream & os) const
+        {
+            double total = 0;
+            for (size_t i = 0; i < _records.size(); ++i)
+                if (_records[i].count)
+                    total += _records[i].time / _records[i].count;
+            os << "{" << std::endl;
+            os << "  \"total_ms\": " << total * 1000.0 << "," << std::endl;
+            os << "  \"layers\": [" << std::endl;
+            for (size_t i = 0, n = 0; i < _records.size(); ++i)
+            {
+                const Record & r = _records[i];
+                if (r.count == 0)
+                    continue;
+                double time = r.time / r.count;
+                os << (n++ ? ",\n" : "") << "    { \"stage\": " << i << ", \"name\": \"" << Escape(r.name) << "\", \"type\": \"" << Escape(r.type) << "\"";
+                os << ", \"count\": " << r.count << ", \"time_ms\": " << time * 1000.0;
+                os << ", \"min_ms\": " << r.min * 1000.0 << ", \"max_ms\": " << r.max * 1000.0;
+                os << ", \"share\": " << (total > 0 ? time / total : 0.0);
+                os << ", \"flop\": " << r.flop << ", \"gflops\": " << (time > 0 ? double(r.flop) / time / 1e9 : 0.0);
+                os << ", \"bytes\": " << r.bytes << ", \"gbps\": " << (time > 0 ? double(r.bytes) / time / 1e9 : 0.0);
+                if (_counters)
+                {
+                    os << ", \"cycles\": " << r.counters[CounterCycles] / r.count;
+                    os << ", \"instructions\": " << r.counters[CounterInstructions] / r.count;
+                    os << ", \"cache_misses\": " << r.counters[CounterCacheMisses] / r.count;
+                }
+                os << " }";
+            }
+            os << std::endl << "  ]" << std::endl << "}" << std::endl;
+        }
+
+        void WriteTrace(std::ostream & os) const
+        {
+            std::streamsize precision = os.precision();
+            os << "{ \"traceEvents\": [" << std::endl;
+            for (size_t i = 0; i < _events.size(); ++i)
+            {
+                const Event & e = _events[i];
+                const Record & r = _records[e.index];
+                os << (i ? ",\n" : "") << "  { \"name\": \"" << Escape(r.name) << "\", \"cat\": \"" << Escape(r.type) << "\", \"ph\": \"X\"";
+                os << ", \"ts\": " << std::fixed << std::setprecision(3) << e.start * 1000000.0;
+                os << ", \"dur\": " << e.duration * 1000000.0 << std::defaultfloat;
+                os << ", \"pid\": 0, \"tid\": 0, \"args\": { \"stage\": " << e.index << ", \"flop\": " << r.flop << ", \"bytes\": " << r.bytes << " } }";
+            }
+            os << std::endl << "], \"displayTimeUnit\": \"ms\" }" << std::endl;
+            os.precision(precision);
+        }
+
+    private:
+        typedef std::chrono::high_resolution_clock Clock;
+
+        struct Record
+        {
+            String name, type;
+            size_t count, bytes;
+            int64_t flop;
+            double time, min, max;
+            uint64_t counters[CounterSize];
+
+            Record(const String & name_ = String(), const String & type_ = String())
+                : name(name_)
+                , type(type_)
+                , count(0)
+                , bytes(0)
+                , flop(0)
+                , time(0)
+                , min(DBL_MAX)
+                , max(0)
+            {
+                for (size_t c = 0; c < CounterSize; ++c)
+                    counters[c] = 0;
+            }
+        };
+        typedef std::vector<Record> Records;
+
+        struct Event
+        {
+            size_t index;
+            double start, duration;
+        };
+        typedef std::vector<Event> Events;
+
+        Records _records;
+        Events _events;
+        size_t _maxEvents;
+        bool _counters;
+        int _fd[CounterSize];
+        uint64_t _start[CounterSize];
+        Clock::time_point _epoch, _time;
+
+        void Read(uint64_t * counters) const
+        {
+            for (size_t c = 0; c < CounterSize; ++c)
+            {
+                counters[c] = 0;
+#if defined(__linux__)
+                if (_fd[c] >= 0 && ::read(_fd[c], counters + c, sizeof(uint64_t)) != sizeof(uint64_t))
+                    counters[c] = 0;
+#endif
+            }
+        }
+
+        void Close()
+        {
+            for (size_t c = 0; c < CounterSize; ++c)
+            {
+#if defined(__linux__)
+                if (_fd[c] >= 0)
+                    ::close(_fd[c]);
+#endif
+                _fd[c] = -1;
+            }
+            _counters = false;
+        }
+
+        static String Escape(const String & src)
+        {
+            String dst;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                unsigned char c = src[i];
+                if (c == '"' || c == '\\')
+                {
+                    dst.push_back('\\');
+                    dst.push_back(c);
+                }
+                else if (c < 0x20)
+                {
+                    const char * hex = "0123456789abcdef";
+                    dst += "\\u00";
+                    dst.push_back(hex[c >> 4]);
+                    dst.push_back(hex[c & 15]);
+                }
+                else
+                    dst.push_back(c);
+            }
+            return dst;
+        }
+
+#if defined(__linux__)
+        static int Open(uint32_t type, uint64_t config)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = type;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1; // counts threads started after Init(), not already running ones.
+            return (int)::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    };
+}
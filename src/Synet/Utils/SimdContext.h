@@ -0,0 +1,96 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Synet/Common.h"
+
+namespace Synet
+{
+    class SimdContext
+    {
+    public:
+        SimdContext()
+            : _owner(false)
+        {
+        }
+
+        SYNET_INLINE void Reset(void * handle = NULL)
+        {
+            _shared.reset(new Shared(handle));
+            _owner = true;
+        }
+
+        SYNET_INLINE void Share(const SimdContext & context)
+        {
+            _shared = context._shared;
+            _owner = false;
+        }
+
+        SYNET_INLINE void * Handle() const
+        {
+            return _shared ? _shared->handle : NULL;
+        }
+
+        SYNET_INLINE bool Owner() const
+        {
+            return _owner;
+        }
+
+        SYNET_INLINE bool NeedParams()
+        {
+            if (_shared && _shared->handle && !_shared->params)
+            {
+                _shared->params = true;
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        struct Shared
+        {
+            void * handle;
+            bool params;
+
+            Shared(void * h)
+                : handle(h)
+                , params(false)
+            {
+            }
+
+            ~Shared()
+            {
+#ifdef SYNET_SIMD_LIBRARY_ENABLE
+                if (handle)
+                    ::SimdRelease(handle);
+#endif
+            }
+        };
+
+        std::shared_ptr<Shared> _shared;
+        bool _owner;
+    };
+}
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "Synet/Tensor.h"
+#include "Synet/Params.h"
 
 namespace Synet
 {
@@ -32,79 +33,83 @@ namespace Synet
     {
         template <typename T> void UpdateChannelsMinMax(const T* src, size_t batch, size_t channels, size_t height, size_t width, TensorFormat format, T* min, T* max)
         {
+            size_t spatial = height * width, spatial4 = spatial & (~size_t(3));
             for (size_t b = 0; b < batch; ++b)
             {
                 if (format == TensorFormatNhwc)
                 {
-                    for (size_t h = 0; h < height; ++h)
+                    for (size_t s = 0; s < spatial; ++s)
                     {
-                        for (size_t w = 0; w < width; ++w)
+                        for (size_t c = 0; c < channels; ++c)
                         {
-                            for (size_t c = 0; c < channels; ++c)
-                            {
-                                T value = src[c];
-                                min[c] = Min(min[c], value);
-                                max[c] = Max(max[c], value);
-                            }
-                            src += channels;
+                            min[c] = Min(min[c], src[c]);
+                            max[c] = Max(max[c], src[c]);
                         }
+                        src += channels;
                     }
                 }
                 else if (format == TensorFormatNchw)
                 {
-					for (size_t c = 0; c < channels; ++c)
-					{
-						for (size_t h = 0; h < height; ++h)
-						{
-							for (size_t w = 0; w < width; ++w)
-							{
-								T value = src[w];
-								min[c] = Min(min[c], value);
-								max[c] = Max(max[c], value);
-							}
-							src += width;
-						}
-					}
+                    for (size_t c = 0; c < channels; ++c)
+                    {
+                        T min0 = min[c], min1 = min[c], min2 = min[c], min3 = min[c];
+                        T max0 = max[c], max1 = max[c], max2 = max[c], max3 = max[c];
+                        size_t s = 0;
+                        for (; s < spatial4; s += 4)
+                        {
+                            min0 = Min(min0, src[s + 0]), max0 = Max(max0, src[s + 0]);
+                            min1 = Min(min1, src[s + 1]), max1 = Max(max1, src[s + 1]);
+                            min2 = Min(min2, src[s + 2]), max2 = Max(max2, src[s + 2]);
+                            min3 = Min(min3, src[s + 3]), max3 = Max(max3, src[s + 3]);
+                        }
+                        for (; s < spatial; ++s)
+                            min0 = Min(min0, src[s]), max0 = Max(max0, src[s]);
+                        min[c] = Min(Min(min0, min1), Min(min2, min3));
+                        max[c] = Max(Max(max0, max1), Max(max2, max3));
+                        src += spatial;
+                    }
                 }
                 else
                     assert(0);
             }
         }
 
+        template <typename T> SYNET_INLINE size_t HistogramIndex(T value, T scale, T shift, size_t size)
+        {
+            int index = (int)(value * scale + shift);
+            return (size_t)Min<int>(Max<int>(index, 0), (int)size - 1);
+        }
+
         template <typename T> void UpdateChannelsHistogram(const T* src, size_t batch, size_t channels, size_t height, size_t width, TensorFormat format, const T* min, const T* max, uint32_t* histogram, size_t size)
         {
+            size_t spatial = height * width;
+            std::vector<T> scale(channels), shift(channels);
+            for (size_t c = 0; c < channels; ++c)
+            {
+                scale[c] = T(size - 1) / (max[c] - min[c]);
+                shift[c] = T(0.5) - min[c] * scale[c];
+            }
             for (size_t b = 0; b < batch; ++b)
             {
                 if (format == TensorFormatNhwc)
                 {
-                    for (size_t h = 0; h < height; ++h)
+                    for (size_t s = 0; s < spatial; ++s)
                     {
-                        for (size_t w = 0; w < width; ++w)
-                        {
-                            for (size_t c = 0; c < channels; ++c)
-                            {
-                                T value = (src[c] - min[c]) / (max[c] - min[c]);
-                                uint32_t index = Round(value * (size - 1));
-                                histogram[c * size + index]++;
-                            }
-                            src += channels;
-                        }
+                        uint32_t * hist = histogram;
+                        for (size_t c = 0; c < channels; ++c, hist += size)
+                            hist[HistogramIndex(src[c], scale[c], shift[c], size)]++;
+                        src += channels;
                     }
                 }
                 else if (format == TensorFormatNchw)
                 {
-                    for (size_t c = 0; c < channels; ++c)
+                    uint32_t * hist = histogram;
+                    for (size_t c = 0; c < channels; ++c, hist += size)
                     {
-                        for (size_t h = 0; h < height; ++h)
-                        {
-                            for (size_t w = 0; w < width; ++w)
-                            {
-                                T value = (src[w] - min[c]) / (max[c] - min[c]);
-                                uint32_t index = Round(value * (size - 1));
-                                histogram[c * size + index]++;
-                            }
-                            src += width;
-                        }
+                        T _scale = scale[c], _shift = shift[c];
+                        for (size_t s = 0; s < spatial; ++s)
+                            hist[HistogramIndex(src[s], _scale, _shift, size)]++;
+                        src += spatial;
                     }
                 }
                 else
@@ -118,7 +123,7 @@ namespace Synet
                 max[c] = min[c] + Max(max[c] - min[c], epsilon);
         }
 
-        template <typename T> void UpdateMinMax(const T* srcMin, T* srcMax, size_t channels, T * dstMin, T * dstMax)
+        template <typename T> void UpdateMinMax(const T* srcMin, const T* srcMax, size_t channels, T * dstMin, T * dstMax)
         {
             for (size_t c = 0; c < channels; ++c)
             {
@@ -127,7 +132,7 @@ namespace Synet
             }
         }
 
-        template <typename T> void UpdateMinMax(const T* srcMin, T* srcMax, size_t channels, uint32_t * histogram, size_t size, size_t threshold, T* dstMin, T* dstMax)
+        template <typename T> void UpdateMinMax(const T* srcMin, const T* srcMax, size_t channels, uint32_t * histogram, size_t size, size_t threshold, T* dstMin, T* dstMax)
         {
             for (size_t c = 0; c < channels; ++c)
             {
@@ -145,6 +150,119 @@ namespace Synet
                 histogram += size;
             }
         }
+
+        template <typename T> void UpdateAbsHistogram(const T* src, size_t batch, size_t channels, size_t spatial, TensorFormat format, const T* scale, size_t stride, uint64_t* histogram, size_t size)
+        {
+            for (size_t b = 0; b < batch; ++b)
+            {
+                if (format == TensorFormatNhwc)
+                {
+                    for (size_t s = 0; s < spatial; ++s)
+                    {
+                        uint64_t* hist = histogram;
+                        for (size_t c = 0; c < channels; ++c, hist += stride)
+                            hist[Min<size_t>(size_t(::fabs(src[c]) * scale[c]), size - 1)]++;
+                        src += channels;
+                    }
+                }
+                else
+                {
+                    uint64_t* hist = histogram;
+                    for (size_t c = 0; c < channels; ++c, hist += stride)
+                    {
+                        T _scale = scale[c];
+                        for (size_t s = 0; s < spatial; ++s)
+                            hist[Min<size_t>(size_t(::fabs(src[s]) * _scale), size - 1)]++;
+                        src += spatial;
+                    }
+                }
+            }
+        }
+
+        SYNET_INLINE size_t PercentileThreshold(const uint64_t* histogram, size_t size, double percentile)
+        {
+            uint64_t total = 0, sum = 0;
+            for (size_t i = 0; i < size; ++i)
+                total += histogram[i];
+            uint64_t limit = uint64_t(::ceil(total * percentile));
+            for (size_t i = 0; i < size; ++i)
+            {
+                sum += histogram[i];
+                if (sum >= limit)
+                    return i + 1;
+            }
+            return size;
+        }
+
+        SYNET_INLINE size_t MseThreshold(const uint64_t* histogram, size_t size, int levels)
+        {
+            double s0 = 0, s1 = 0, s2 = 0, inside = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                double c = i + 0.5, n = double(histogram[i]);
+                s0 += n, s1 += n * c, s2 += n * c * c;
+            }
+            size_t best = size;
+            double bestError = DBL_MAX;
+            for (size_t i = 1; i <= size; ++i)
+            {
+                double n = double(histogram[i - 1]), c = i - 0.5, t = double(i), step = t / levels;
+                inside += n, s0 -= n, s1 -= n * c, s2 -= n * c * c;
+                double error = inside * step * step / 12.0 + s2 - 2.0 * t * s1 + t * t * s0;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = i;
+                }
+            }
+            return best;
+        }
+
+        SYNET_INLINE size_t EntropyThreshold(const uint64_t* histogram, size_t size, size_t levels)
+        {
+            if (size <= levels)
+                return size;
+            std::vector<double> p(size), q(size);
+            size_t best = size;
+            double bestDivergence = DBL_MAX;
+            for (size_t i = levels; i <= size; ++i)
+            {
+                double outliers = 0;
+                for (size_t j = i; j < size; ++j)
+                    outliers += double(histogram[j]);
+                for (size_t j = 0; j < i; ++j)
+                    p[j] = double(histogram[j]);
+                p[i - 1] += outliers;
+                for (size_t l = 0; l < levels; ++l)
+                {
+                    size_t beg = l * i / levels, end = (l + 1) * i / levels;
+                    double sum = 0, nonzero = 0;
+                    for (size_t j = beg; j < end; ++j)
+                        sum += double(histogram[j]), nonzero += histogram[j] ? 1 : 0;
+                    for (size_t j = beg; j < end; ++j)
+                        q[j] = histogram[j] ? sum / nonzero : 0.0;
+                }
+                double sumP = 0, sumQ = 0;
+                for (size_t j = 0; j < i; ++j)
+                    sumP += p[j], sumQ += q[j];
+                if (sumP == 0 || sumQ == 0)
+                    continue;
+                double divergence = 0;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (p[j] == 0)
+                        continue;
+                    double _p = p[j] / sumP, _q = Max(q[j] / sumQ, 1e-10);
+                    divergence += _p * ::log(_p / _q);
+                }
+                if (divergence < bestDivergence)
+                {
+                    bestDivergence = divergence;
+                    best = i;
+                }
+            }
+            return best;
+        }
     }
 
     template <typename T> size_t GetChannels(const Tensor<T>& tensor)
@@ -161,6 +279,113 @@ namespace Synet
         return 0;
     }
 
+    template <typename T> void GetChannelsShape(const Tensor<T>& tensor, size_t & batch, size_t & channels, size_t & spatial)
+    {
+        batch = 0, channels = 0, spatial = 0;
+        if (tensor.Count() == 4)
+        {
+            batch = tensor.Axis(0);
+            if (tensor.Format() == TensorFormatNhwc)
+                channels = tensor.Axis(3), spatial = tensor.Axis(1) * tensor.Axis(2);
+            else if (tensor.Format() == TensorFormatNchw)
+                channels = tensor.Axis(1), spatial = tensor.Axis(2) * tensor.Axis(3);
+        }
+        if (tensor.Count() == 2)
+            batch = tensor.Axis(0), channels = tensor.Axis(1), spatial = 1;
+    }
+
+    class CalibrationHistogram
+    {
+    public:
+        CalibrationHistogram()
+            : _channels(0)
+            , _size(0)
+        {
+        }
+
+        void Init(const float* min, const float* max, size_t channels, size_t size, bool perChannel)
+        {
+            _channels = channels;
+            _size = size;
+            _range.resize(perChannel ? channels : 1, 0.0f);
+            for (size_t c = 0; c < channels; ++c)
+            {
+                float & range = _range[perChannel ? c : 0];
+                range = Max(range, Max(::fabs(min[c]), ::fabs(max[c])));
+            }
+            _scale.resize(channels);
+            for (size_t c = 0; c < channels; ++c)
+            {
+                float range = _range[perChannel ? c : 0];
+                _scale[c] = range > 0.0f ? float(size) / range : 0.0f;
+            }
+            _histogram.assign(_range.size() * size, 0);
+        }
+
+        bool Enable() const
+        {
+            return _size != 0;
+        }
+
+        void Update(const Tensor<float>& tensor)
+        {
+            size_t batch, channels, spatial;
+            GetChannelsShape(tensor, batch, channels, spatial);
+            assert(channels == _channels);
+            Detail::UpdateAbsHistogram(tensor.CpuData(), batch, channels, spatial, tensor.Format(), 
+                _scale.data(), _range.size() > 1 ? _size : 0, _histogram.data(), _size);
+        }
+
+        bool Merge(const CalibrationHistogram& other)
+        {
+            if (!Enable())
+            {
+                *this = other;
+                return true;
+            }
+            if (_histogram.size() != other._histogram.size() || _range != other._range)
+                return false;
+            for (size_t i = 0; i < _histogram.size(); ++i)
+                _histogram[i] += other._histogram[i];
+            return true;
+        }
+
+        void Calibrate(CalibrationMethod method, float percentile, int levels, float* min, float* max) const
+        {
+            for (size_t r = 0; r < _range.size(); ++r)
+            {
+                const uint64_t* histogram = _histogram.data() + r * _size;
+                size_t threshold = _size;
+                switch (method)
+                {
+                case CalibrationMethodPercentile:
+                    threshold = Detail::PercentileThreshold(histogram, _size, percentile);
+                    break;
+                case CalibrationMethodMse:
+                    threshold = Detail::MseThreshold(histogram, _size, levels);
+                    break;
+                case CalibrationMethodEntropy:
+                    threshold = Detail::EntropyThreshold(histogram, _size, levels + 1);
+                    break;
+                default:
+                    break;
+                }
+                float limit = _range[r] * threshold / _size;
+                size_t beg = _range.size() > 1 ? r : 0, end = _range.size() > 1 ? r + 1 : _channels;
+                for (size_t c = beg; c < end; ++c)
+                {
+                    min[c] = Max(min[c], -limit);
+                    max[c] = Min(max[c], limit);
+                }
+            }
+        }
+
+    private:
+        size_t _channels, _size;
+        std::vector<float> _range, _scale;
+        std::vector<uint64_t> _histogram;
+    };
+
     template <typename T> void UpdateChannelsQuantile(const Tensor<T>& tensor, T quntile, T epsilon, T * lower, T * upper)
     {
         size_t batch = 0, channels = 0, height = 0, width = 0;
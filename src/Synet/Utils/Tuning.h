@@ -0,0 +1,129 @@
+/*
+* Synet Framework (http://github.com/ermig1979/Synet).
+*
+* Copyright (c) 2018-2021 Yermalayeu Ihar.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#pragma once
+
+#include "Synet/Common.h"
+
+#include <chrono>
+
+namespace Synet
+{
+    class TuningCache
+    {
+    public:
+        TuningCache()
+            : _changed(false)
+        {
+        }
+
+        bool Load(const String& path)
+        {
+            std::ifstream ifs(path.c_str());
+            if (!ifs.is_open())
+                return false;
+            String key;
+            int value;
+            while (ifs >> key >> value)
+                _values[key] = value;
+            ifs.close();
+            _checked.clear();
+            _changed = false;
+            return true;
+        }
+
+        bool Save(const String& path)
+        {
+            std::ofstream ofs(path.c_str());
+            if (!ofs.is_open())
+                return false;
+            for (Values::const_iterator it = _values.begin(); it != _values.end(); ++it)
+                ofs << it->first << " " << it->second << std::endl;
+            bool result = (bool)ofs;
+            ofs.close();
+            _changed = !result;
+            return result;
+        }
+
+        bool Get(const String& key, int& value) const
+        {
+            Values::const_iterator it = _values.find(key);
+            if (it == _values.end())
+                return false;
+            value = it->second;
+            return true;
+        }
+
+        void Set(const String& key, int value)
+        {
+            _values[key] = value;
+            _checked.insert(key);
+            _changed = true;
+        }
+
+        bool Checked(const String& key) const
+        {
+            return _checked.find(key) != _checked.end();
+        }
+
+        void SetChecked(const String& key)
+        {
+            _checked.insert(key);
+        }
+
+        bool Changed() const
+        {
+            return _changed;
+        }
+
+        void Clear()
+        {
+            _values.clear();
+            _checked.clear();
+            _changed = false;
+        }
+
+    private:
+        typedef std::map<String, int> Values;
+        Values _values;
+        std::set<String> _checked;
+        bool _changed;
+    };
+
+    template<class Function> double TuningTime(Function function, double minTime = 0.010, size_t maxRepeats = 16)
+    {
+        typedef std::chrono::high_resolution_clock Clock;
+        function();
+        double best = DBL_MAX, total = 0.0;
+        for (size_t r = 0; r < maxRepeats && (r < 3 || total < minTime); ++r)
+        {
+            Clock::time_point start = Clock::now();
+            function();
+            double time = std::chrono::duration<double>(Clock::now() - start).count();
+            best = std::min(best, time);
+            total += time;
+        }
+        return best;
+    }
+}
@@ -841,15 +841,24 @@ namespace Synet
     public:
         Winograd()
             : _type(Winograd::WinogradNone)
+            , _filterType(Winograd::WinogradNone)
+            , _owner(false)
         {
         }
 
-        void Init(Shape src, size_t dst, Shape kernel, Shape stride, Shape dilation, Shape pad, size_t group)
+        void Share(const Winograd & other)
+        {
+            *this = other;
+            _owner = false;
+        }
+
+        void Init(Shape src, size_t dst, Shape kernel, Shape stride, Shape dilation, Shape pad, size_t group, size_t block = 2)
         {
             assert(src.size() == 3 && kernel.size() == 2 && stride.size() == 2 && dilation.size() == 2 && pad.size() == 4);
+            _type = Winograd::WinogradNone;
             if (stride[0] != 1 || stride[1] != 1 || dilation[0] != 1 || dilation[1] != 1)
                 return;
-            if (!((pad[0] == 0 && pad[1] == 0) || (pad[0] == 1 && pad[1] == 1)))
+            if (!((pad[0] == 0 && pad[1] == 0 && pad[2] == 0 && pad[3] == 0) || (pad[0] == 1 && pad[1] == 1 && pad[2] == 1 && pad[3] == 1)))
                 return;
             if (group != 1)
                 return;
@@ -874,9 +883,7 @@ namespace Synet
 
                 if (src[0] < 16)
                     return;
-                else
-
-                if (1)
+                else if (block == 2)
                 {
                     _block = 2;
                     _count = 16;
@@ -897,16 +904,25 @@ namespace Synet
             }
         }
 
-        bool Enable()
+        bool Enable() const
         {
             return _type != Winograd::WinogradNone;
         }
 
+        size_t MemoryUsage() const
+        {
+            return _owner ? _filter.MemoryUsage() : 0;
+        }
+
         void SetFilter(const T * src)
         {
             SYNET_PERF_FUNC();
 
-            _filter.Reshape({ _count, _strideF }, 0);
+            if (_filterType == _type && _filter.Size() == _count * _strideF)
+                return;
+            _filter = Tensor({ _count, _strideF }, 0);
+            _filterType = _type;
+            _owner = true;
             switch (_type)
             {
             case Winograd::Winograd2x3i:
@@ -953,7 +969,7 @@ namespace Synet
             Winograd2x3i,
             Winograd2x3p,
             Winograd4x3p,
-        } _type;  
+        } _type, _filterType;
 
         bool _pad;
         size_t _srcC, _srcW, _srcH, _dstC, _dstH, _dstW;
@@ -961,6 +977,7 @@ namespace Synet
         size_t _group, _wStep, _dStep;
         
         Tensor _filter;
+        bool _owner;
         const T * _weight;
 
         void SetInput(const T * src, T * dst)
@@ -1004,7 +1021,7 @@ namespace Synet
                     const T * a = _filter.CpuData() + i * _strideF;
                     const T * b = src + i * _strideS;
                     T * c = dst + i * _strideD;
-                    CpuGemm(CblasNoTrans, CblasNoTrans, M, N, K, T(1.0), a, b, T(0.0), c);
+                    CpuGemm(CblasNoTrans, CblasNoTrans, M, N, K, T(1.0), a, K, b, N, T(0.0), c, N);
                 }
                 break;
             }
@@ -36,6 +36,13 @@
 //#define SYNET_PERFORMANCE_STATISTIC
 
 //#define SYNET_TEST_MEMORY_LOAD
+//#define SYNET_TEST_MEMORY_PLANNING
+//#define SYNET_TEST_MEMORY_PLANNING_CHECK
+//#define SYNET_TEST_MEMORY_MAPPED
+//#define SYNET_TEST_SHARED_WEIGHT
+//#define SYNET_TEST_INTER_OP_THREADS 4
+//#define SYNET_TEST_RESHAPE_CACHE 4
+//#define SYNET_TEST_TUNING_CACHE "synet_tuning.txt"
 //#define SYNET_TEST_NET_RESHAPE
 //#define SYNET_TEST_SET_INPUT
 //#define SYNET_TEST_STB_EXTERNAL
@@ -52,6 +59,8 @@
 #include <fstream>
 #include <iomanip>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <map>
@@ -751,7 +751,7 @@ namespace Test
 #ifdef SYNET_TEST_FIRST_RUN 
             if (_options.enable & ENABLE_FIRST)
             {
-                if (thread && !InitNetwork(_options.firstModel, _options.firstWeight, _firsts[thread]))
+                if (thread && !_firsts[thread].Clone(_firsts[0]) && !InitNetwork(_options.firstModel, _options.firstWeight, _firsts[thread]))
                     ::exit(0);
                 _threads[thread].first = true;
                 std::mutex mutex;
@@ -798,7 +798,7 @@ namespace Test
 #ifdef SYNET_TEST_SECOND_RUN 
             if (_options.enable & ENABLE_SECOND)
             {
-                if (thread && !InitNetwork(_options.secondModel, _options.secondWeight, _seconds[thread]))
+                if (thread && !_seconds[thread].Clone(_seconds[0]) && !InitNetwork(_options.secondModel, _options.secondWeight, _seconds[thread]))
                     ::exit(0);
                 _threads[thread].second = true;
                 std::mutex mutex;
@@ -842,6 +842,7 @@ namespace Test
 
         static void TestThread(Comparer* comparer, size_t thread, size_t total)
         {
+            TEST_PERF_FUNC();
             const Options& options = comparer->_options;
             size_t current = 0, networks = 1;
 #if defined(SYNET_TEST_FIRST_RUN) && defined(SYNET_TEST_SECOND_RUN)
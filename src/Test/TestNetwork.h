@@ -133,6 +133,7 @@ namespace Test
         virtual Shape SrcShape(size_t index) const { return Shape(); }
         virtual size_t SrcSize(size_t index) const { return 0; }
         virtual bool Init(const String & model, const String & weight, const Options & options, const TestParam & param) { return false; }
+        virtual bool Clone(const Network & network) { return false; }
         virtual void Free() { _output.clear(); }
         virtual const Tensors& Predict(const Tensors& src) { return _output; }
         virtual void DebugPrint(const Tensors& src, std::ostream & os, int flag, int first, int last, int precision) { }
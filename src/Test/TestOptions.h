@@ -74,6 +74,7 @@ namespace Test
         float regionThreshold;
         float regionOverlap;
         double statFilter;
+        String timelineName;
 
         mutable bool result;
         mutable size_t firstMemoryUsage,  secondMemoryUsage;
@@ -123,6 +124,9 @@ namespace Test
             regionThreshold = FromString<float>(GetArg("-rt", "0.3"));
             regionOverlap = FromString<float>(GetArg("-ro", "0.5"));
             statFilter = FromString<double>(GetArg("-sf", "0.0"));
+            timelineName = GetArg("-tln", "", false);
+            if (!timelineName.empty())
+                PerformanceMeasurerStorage::s_storage.Timeline().Enable();
             if (enable < 1 || enable > 3)
             {
                 std::cout << "Parameter '-e' (enable) must be only 1, 2, 3!" << std::endl;
@@ -132,6 +136,12 @@ namespace Test
 
         ~Options()
         {
+            if (!timelineName.empty() && CreateOutputDirectory(timelineName))
+            {
+                std::ofstream timeline(timelineName.c_str());
+                if (timeline.is_open())
+                    PerformanceMeasurerStorage::s_storage.Timeline().Write(timeline);
+            }
             if (mode == "compare" && result)
             {
                 std::stringstream ss;
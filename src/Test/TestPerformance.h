@@ -26,6 +26,8 @@
 
 #include "TestUtils.h"
 
+#include <atomic>
+
 #if defined(_MSC_VER)
 #ifndef NOMINMAX
 #define NOMINMAX
@@ -102,6 +104,10 @@ namespace Test
         return double(count) / double(TimeFrequency()) * 1000.0;
     }
 
+    class PerformanceMeasurer;
+
+    inline void TimelineAdd(const PerformanceMeasurer * pm, int64_t begin, int64_t end);
+
     //-------------------------------------------------------------------------
 
     class PerformanceMeasurer
@@ -155,7 +161,9 @@ namespace Test
                 if (_entered)
                 {
                     _entered = false;
-                    _current += TimeCounter() - _start;
+                    int64_t finish = TimeCounter();
+                    _current += finish - _start;
+                    TimelineAdd(this, _start, finish);
                 }
                 if (!pause)
                 {
@@ -245,6 +253,106 @@ namespace Test
 
     //-------------------------------------------------------------------------
 
+    class TimelineRecorder
+    {
+        struct Event
+        {
+            const PerformanceMeasurer * pm;
+            int64_t begin, end;
+        };
+
+        struct Ring
+        {
+            std::vector<Event> events;
+            std::atomic<size_t> head;
+            size_t index;
+
+            Ring(size_t size, size_t index_)
+                : events(size)
+                , head(0)
+                , index(index_)
+            {
+            }
+        };
+        typedef std::shared_ptr<Ring> RingPtr;
+        typedef std::vector<RingPtr> Rings;
+
+        Rings _rings;
+        size_t _size;
+        std::atomic<bool> _enabled;
+        mutable std::mutex _mutex;
+
+        inline Ring & ThisThread()
+        {
+            static thread_local Ring * ring = NULL;
+            if (ring == NULL)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _rings.push_back(RingPtr(new Ring(_size, _rings.size())));
+                ring = _rings.back().get();
+            }
+            return *ring;
+        }
+
+        static inline String Escape(const String & src)
+        {
+            String dst;
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                unsigned char c = src[i];
+                if (c == '"' || c == '\\')
+                {
+                    dst.push_back('\\');
+                    dst.push_back(c);
+                }
+                else if (c < 0x20)
+                {
+                    const char * hex = "0123456789abcdef";
+                    dst += "\\u00";
+                    dst.push_back(hex[c >> 4]);
+                    dst.push_back(hex[c & 15]);
+                }
+                else
+                    dst.push_back(c);
+            }
+            return dst;
+        }
+
+    public:
+        TimelineRecorder()
+            : _size(0)
+            , _enabled(false)
+        {
+        }
+
+        inline void Enable(size_t size = 256 * 1024)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _size = std::max<size_t>(size, 1);
+            _enabled = true;
+        }
+
+        inline bool Enabled() const
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        inline void Add(const PerformanceMeasurer * pm, int64_t begin, int64_t end)
+        {
+            Ring & ring = ThisThread();
+            size_t head = ring.head.load(std::memory_order_relaxed);
+            Event & event = ring.events[head % ring.events.size()];
+            event.pm = pm;
+            event.begin = begin;
+            event.end = end;
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+
+        void Write(std::ostream & os) const;
+    };
+
+    //-------------------------------------------------------------------------
+
     class PerformanceMeasurerStorage
     {
         typedef PerformanceMeasurer Pm;
@@ -253,6 +361,7 @@ namespace Test
         typedef std::map<std::thread::id, FunctionMap> ThreadMap;
 
         ThreadMap _map;
+        TimelineRecorder _timeline;
         mutable std::mutex _mutex;
 
         inline FunctionMap & ThisThread()
@@ -318,6 +427,11 @@ namespace Test
             _map.clear();
         }
 
+        inline TimelineRecorder & Timeline()
+        {
+            return _timeline;
+        }
+
         void Print(std::ostream & os, double threshold = 0, const String & main = "Network::Predict", const String& term = "Layer::Forward")
         {
             if (this == 0)
@@ -400,6 +514,47 @@ namespace Test
             return combined;
         }
     };
+
+    //-------------------------------------------------------------------------
+
+    inline void TimelineAdd(const PerformanceMeasurer * pm, int64_t begin, int64_t end)
+    {
+        TimelineRecorder & timeline = PerformanceMeasurerStorage::s_storage.Timeline();
+        if (timeline.Enabled())
+            timeline.Add(pm, begin, end);
+    }
+
+    inline void TimelineRecorder::Write(std::ostream & os) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int64_t epoch = std::numeric_limits<int64_t>::max();
+        for (size_t r = 0; r < _rings.size(); ++r)
+        {
+            const Ring & ring = *_rings[r];
+            size_t head = ring.head.load(std::memory_order_acquire), size = ring.events.size();
+            for (size_t i = head > size ? head - size : 0; i < head; ++i)
+                epoch = std::min(epoch, ring.events[i % size].begin);
+        }
+        double scale = 1000000.0 / double(TimeFrequency());
+        os << "{ \"traceEvents\": [" << std::endl;
+        os << std::fixed << std::setprecision(3);
+        bool first = true;
+        for (size_t r = 0; r < _rings.size(); ++r)
+        {
+            const Ring & ring = *_rings[r];
+            os << (first ? "" : ",\n") << "  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << ring.index;
+            os << ", \"args\": { \"name\": \"" << "thread " << ring.index << "\" } }";
+            first = false;
+            size_t head = ring.head.load(std::memory_order_acquire), size = ring.events.size();
+            for (size_t i = head > size ? head - size : 0; i < head; ++i)
+            {
+                const Event & event = ring.events[i % size];
+                os << ",\n  { \"name\": \"" << Escape(event.pm->Name()) << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << ring.index;
+                os << ", \"ts\": " << double(event.begin - epoch) * scale << ", \"dur\": " << double(event.end - event.begin) * scale << " }";
+            }
+        }
+        os << std::endl << "], \"displayTimeUnit\": \"ms\" }" << std::endl;
+    }
 }
 
 #ifdef _MSC_VER
@@ -31,6 +31,7 @@
 
 #include "Synet/Converters/Deoptimizer.h"
 #include "Synet/Converters/Optimizer.h"
+#include "Synet/Utils/Difference.h"
 
 namespace Test
 {
@@ -38,15 +39,22 @@ namespace Test
     {
         SYNET_PARAM_VALUE(Synet::QuantizationMethod, method, Synet::QuantizationMethodUnknown);
         SYNET_PARAM_VALUE(float, truncationQuantile, 0.0f);
+        SYNET_PARAM_VALUE(Synet::CalibrationMethod, calibrationMethod, Synet::CalibrationMethodQuantile);
+        SYNET_PARAM_VALUE(float, calibrationPercentile, 0.9999f);
+        SYNET_PARAM_VALUE(int, calibrationBins, 1024);
         SYNET_PARAM_VALUE(int, imageBegin, 0);
         SYNET_PARAM_VALUE(int, imageEnd, 1000000);
         SYNET_PARAM_VALUE(bool, depthwiseConvolution, false);
         SYNET_PARAM_VALUE(bool, degenerateConvolution, false);
+        SYNET_PARAM_VALUE(bool, deconvolution, false);
         SYNET_PARAM_VALUE(bool, scaleToConvolution, false);
         SYNET_PARAM_VALUE(bool, eltwiseToAdd, true);
         SYNET_PARAM_VALUE(bool, concatCan8i, true);
         SYNET_PARAM_VALUE(int, innerProductWeightMin, 0);
         SYNET_PARAM_VALUE(Strings, skippedLayers, Strings());
+        SYNET_PARAM_VALUE(bool, mixedPrecision, false);
+        SYNET_PARAM_VALUE(int, mixedPrecisionImages, 10);
+        SYNET_PARAM_VALUE(float, mixedPrecisionError, 0.0f);
     };
 
     SYNET_PARAM_HOLDER(QuantParamHolder, QuantParam, quant);    
@@ -100,6 +108,19 @@ namespace Test
         String _progressMessage;
         typedef std::vector<Synet::LayerParam> LayerParams;
 
+        struct SearchLayer
+        {
+            String name;
+            int64_t flop;
+            double error, score;
+        };
+        typedef std::vector<SearchLayer> SearchLayers;
+        typedef std::vector<SyNet::Tensor> Outputs;
+        std::vector<char> _weight;
+        std::vector<Outputs> _reference;
+        Strings _outputNames;
+        double _referenceTime;
+
         void PrintStartMessage()
         {
             _progressMessage = _options.consoleSilence ? 
@@ -153,7 +174,9 @@ namespace Test
         {
             if (!_options.consoleSilence)
                 std::cout << "Optimize Synet FP32 model : ";
-            bool result = Synet::OptimizeSynetModel(_options.firstModel, "", _opt, "");
+            Synet::OptimizerParamHolder param;
+            param().mergeElementwise() = false;
+            bool result = Synet::OptimizeSynetModel(_options.firstModel, "", _opt, "", param());
             if (!_options.consoleSilence)
                 std::cout << (result ? " OK." : "Optimization is finished with errors!") << std::endl;
             return result;
@@ -175,10 +198,12 @@ namespace Test
         {
             bool result = InitSynet(_deopt, _options.firstWeight);
             result = result && CreateImageList();
-            for (size_t i = 0; i < _images.size() && result; ++i)
+            result = result && ProcessImages(false);
+            if (result && _quant().calibrationMethod() != Synet::CalibrationMethodQuantile)
             {
-                std::cout << "\r" << _progressMessage << ToString(100.0 * i / _images.size(), 1) << "% " << std::flush;
-                result = result && UpdateStatistics(_images[i]);
+                result = ProcessImages(true);
+                if (result)
+                    _synet.CalibrateStatistics(_quant().calibrationMethod(), _quant().calibrationPercentile(), _quant().method());
             }
             result = result && _synet.Save(_stats);
             if (!_options.consoleSilence)
@@ -187,6 +212,58 @@ namespace Test
             return result;
         }
 
+        bool ProcessImages(bool histogram)
+        {
+            if (_options.TestThreads() > 1 && _images.size() > 1)
+                return ProcessImagesMultiThreads(histogram);
+            bool result = true;
+            for (size_t i = 0; i < _images.size() && result; ++i)
+            {
+                std::cout << "\r" << _progressMessage << ToString(100.0 * i / _images.size(), 1) << "% " << std::flush;
+                result = result && UpdateStatistics(_synet, _images[i], histogram);
+            }
+            return result;
+        }
+
+        bool ProcessImagesMultiThreads(bool histogram)
+        {
+            size_t threads = std::min(_options.TestThreads(), _images.size());
+            std::vector<std::shared_ptr<SyNet>> networks(threads);
+            for (size_t t = 0; t < threads; ++t)
+            {
+                networks[t].reset(new SyNet());
+                if (!_synet.Clone(*networks[t]))
+                {
+                    std::cout << "Can't clone Synet model for statistics collection!" << std::endl;
+                    return false;
+                }
+            }
+            std::atomic<size_t> processed(0), finished(0);
+            std::vector<char> results(threads, 1);
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t)
+            {
+                workers.push_back(std::thread([&, t]()
+                {
+                    for (size_t i = t; i < _images.size() && results[t]; i += threads, ++processed)
+                        results[t] = UpdateStatistics(*networks[t], _images[i], histogram) ? 1 : 0;
+                    ++finished;
+                }));
+            }
+            while (finished < threads)
+            {
+                std::cout << "\r" << _progressMessage << ToString(100.0 * processed / _images.size(), 1) << "% " << std::flush;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            bool result = true;
+            for (size_t t = 0; t < threads; ++t)
+            {
+                workers[t].join();
+                result = result && results[t] && _synet.MergeStatistics(*networks[t]);
+            }
+            return result;
+        }
+
         bool InitSynet(const String& model, const String& weight)
         {
             if (!_synet.Load(model, weight))
@@ -238,7 +315,7 @@ namespace Test
             return true;
         }
 
-        bool UpdateStatistics(const String& path)
+        bool SetInput(SyNet& synet, const String& path)
         {
             View original;
             if (!LoadImage(path, original))
@@ -246,15 +323,27 @@ namespace Test
                 std::cout << "Can't load image in '" << path << "' !" << std::endl;
                 return false;
             }
-            View resized(_synet.NchwShape()[3], _synet.NchwShape()[2], original.format);
+            View resized(synet.NchwShape()[3], synet.NchwShape()[2], original.format);
             Simd::Resize(original, resized, SimdResizeMethodArea);
-            if (!_synet.SetInput(resized, _param().lower(), _param().upper()))
+            if (!synet.SetInput(resized, _param().lower(), _param().upper()))
             {
                 std::cout << "Can't set input for '" << path << "' image !" << std::endl;
                 return false;
             }
-            _synet.Forward();
-            _synet.UpdateStatistics(_quant().truncationQuantile(), 0.000001f);
+            return true;
+        }
+
+        bool UpdateStatistics(SyNet & synet, const String& path, bool histogram)
+        {
+            if (!SetInput(synet, path))
+                return false;
+            synet.Forward();
+            if (histogram)
+                synet.UpdateHistograms(_quant().calibrationMethod(), _quant().calibrationBins());
+            else if (_quant().calibrationMethod() == Synet::CalibrationMethodQuantile)
+                synet.UpdateStatistics(_quant().truncationQuantile(), 0.000001f);
+            else
+                synet.UpdateStatistics(0.0f, 0.000001f);
             return true;
         }
 
@@ -325,6 +414,15 @@ namespace Test
             layer.convolution().quantizationLevel() = Synet::TensorType8i;
         }
 
+        void QuantizeDeconvolution(Synet::LayerParam& layer)
+        {
+            if (layer.type() != Synet::LayerTypeDeconvolution || !_quant().deconvolution())
+                return;
+            if (layer.convolution().group() != 1 && !_quant().depthwiseConvolution())
+                return;
+            layer.convolution().quantizationLevel() = Synet::TensorType8i;
+        }
+
         void QuantizeInnerProduct(Synet::LayerParam& layer)
         {
             if (layer.type() != Synet::LayerTypeInnerProduct)
@@ -363,6 +461,222 @@ namespace Test
             layer.concat().can8i() = _quant().concatCan8i();
         }
 
+        static Synet::TensorType* QuantizationLevel(Synet::LayerParam& layer)
+        {
+            if (layer.type() == Synet::LayerTypeConvolution || layer.type() == Synet::LayerTypeDeconvolution)
+                return &layer.convolution().quantizationLevel();
+            if (layer.type() == Synet::LayerTypeInnerProduct)
+                return &layer.innerProduct().quantizationLevel();
+            return NULL;
+        }
+
+        static void SetQuantizationLevel(Synet::NetworkParam& network, const String& name, Synet::TensorType level)
+        {
+            for (size_t i = 0; i < network.layers().size(); ++i)
+            {
+                Synet::LayerParam& layer = network.layers()[i];
+                if (layer.name() == name && QuantizationLevel(layer))
+                    *QuantizationLevel(layer) = level;
+            }
+        }
+
+        bool InitSearch(const Synet::NetworkParam& network)
+        {
+            std::ifstream ifs(_options.firstWeight.c_str(), std::ifstream::binary);
+            if (!ifs.is_open())
+            {
+                std::cout << "Can't open weight file '" << _options.firstWeight << "' !" << std::endl;
+                return false;
+            }
+            _weight.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            ifs.close();
+            Synet::NetworkParamHolder fp32;
+            fp32() = network;
+            for (size_t i = 0; i < fp32().layers().size(); ++i)
+            {
+                Synet::TensorType* level = QuantizationLevel(fp32().layers()[i]);
+                if (level != NULL && *level == Synet::TensorType8i)
+                    *level = Synet::TensorType32f;
+            }
+            SyNet synet;
+            if (!LoadNetwork(fp32(), synet))
+                return false;
+            _outputNames.clear();
+            for (size_t d = 0; d < synet.Dst().size(); ++d)
+                _outputNames.push_back(synet.Dst()[d]->Name());
+            _reference.resize(std::min(_images.size(), (size_t)std::max(_quant().mixedPrecisionImages(), 1)));
+            if (!SetInput(synet, _images[0]))
+                return false;
+            synet.Forward();
+            _referenceTime = 0;
+            for (size_t i = 0; i < _reference.size(); ++i)
+            {
+                if (!SetInput(synet, _images[i]))
+                    return false;
+                double start = Time();
+                synet.Forward();
+                _referenceTime += Time() - start;
+                _reference[i].resize(_outputNames.size());
+                for (size_t d = 0; d < _outputNames.size(); ++d)
+                    _reference[i][d].Clone(*synet.Dst()[d]);
+            }
+            return true;
+        }
+
+        bool LoadNetwork(const Synet::NetworkParam& param, SyNet& synet)
+        {
+            Synet::NetworkParamHolder network;
+            network() = param;
+            Floats bin;
+            Synet::OptimizerParamHolder optimizerParam;
+            Synet::Optimizer optimizer(optimizerParam());
+            if (!optimizer.Run(network(), bin))
+            {
+                std::cout << "Can't optimize Synet model!" << std::endl;
+                return false;
+            }
+            std::stringstream model;
+            network.Save(model, false);
+            String xml = model.str();
+            if (!synet.Load(xml.c_str(), xml.size(), _weight.data(), _weight.size()))
+            {
+                std::cout << "Can't load Synet model for precision estimation!" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        double OutputError(const SyNet::Tensor& first, const SyNet::Tensor& second, bool& passed) const
+        {
+            if (first.Shape() != second.Shape())
+            {
+                passed = false;
+                return 1.0;
+            }
+            Synet::Difference<float> difference(first, second);
+            if (difference.Valid())
+            {
+                passed = difference.Estimate(_options.compareThreshold, _options.compareQuantile) && passed;
+                return difference.GetStatistics().adev;
+            }
+            double sum = 0;
+            size_t size = first.Size(), exceed = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                double diff = Synet::Abs(first.CpuData()[i] - second.CpuData()[i]);
+                sum += diff;
+                if (diff >= _options.compareThreshold)
+                    exceed++;
+            }
+            passed = passed && size_t(_options.compareQuantile * size) >= exceed;
+            return size ? sum / size : 0.0;
+        }
+
+        bool EstimateNetwork(const Synet::NetworkParam& param, bool& passed, double& error, double& time)
+        {
+            SyNet synet;
+            if (!LoadNetwork(param, synet))
+                return false;
+            if (!SetInput(synet, _images[0]))
+                return false;
+            synet.Forward();
+            passed = true, error = 0, time = 0;
+            for (size_t i = 0; i < _reference.size(); ++i)
+            {
+                if (!SetInput(synet, _images[i]))
+                    return false;
+                double start = Time();
+                synet.Forward();
+                time += Time() - start;
+                for (size_t d = 0; d < _outputNames.size(); ++d)
+                {
+                    const SyNet::Tensor* dst = synet.Dst(_outputNames[d]);
+                    if (dst == NULL)
+                    {
+                        std::cout << "Can't find output '" << _outputNames[d] << "' in quantized Synet model!" << std::endl;
+                        return false;
+                    }
+                    error += OutputError(_reference[i][d], *dst, passed);
+                }
+            }
+            error /= double(_reference.size() * _outputNames.size());
+            if (_quant().mixedPrecisionError() > 0.0f && error > _quant().mixedPrecisionError())
+                passed = false;
+            return true;
+        }
+
+        bool SearchMixedPrecision(Synet::NetworkParam& network)
+        {
+            std::map<String, int64_t> flops;
+            for (size_t i = 0; i < _synet.StageCount(); ++i)
+                flops[_synet.StageLayer(i)->Param().name()] = _synet.StageLayer(i)->Flop();
+            SearchLayers layers;
+            int64_t flop8i = 0;
+            for (size_t i = 0; i < network.layers().size(); ++i)
+            {
+                Synet::TensorType* level = QuantizationLevel(network.layers()[i]);
+                if (level == NULL || *level != Synet::TensorType8i)
+                    continue;
+                SearchLayer layer;
+                layer.name = network.layers()[i].name();
+                layer.flop = std::max<int64_t>(flops[layer.name], 1);
+                layer.error = 0, layer.score = 0;
+                layers.push_back(layer);
+                flop8i += layer.flop;
+            }
+            if (layers.empty())
+                return true;
+            if (!InitSearch(network))
+                return false;
+
+            bool passed;
+            double error, time;
+            if (!EstimateNetwork(network, passed, error, time))
+                return false;
+            double gain = std::max(_referenceTime - time, 0.0) / double(flop8i);
+            if (!_options.consoleSilence)
+                std::cout << std::endl << "Mixed precision search: " << layers.size() << " INT8 layers, error = " << ToString(error, 6)
+                    << ", speedup = " << ToString(_referenceTime / time, 2) << (passed ? " (passed)." : " (failed).") << std::endl;
+            if (passed)
+                return true;
+
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                bool layerPassed;
+                double layerError, layerTime;
+                SetQuantizationLevel(network, layers[i].name, Synet::TensorType32f);
+                if (!EstimateNetwork(network, layerPassed, layerError, layerTime))
+                    return false;
+                SetQuantizationLevel(network, layers[i].name, Synet::TensorType8i);
+                layers[i].error = error - layerError;
+                layers[i].score = layers[i].error / std::max(double(layers[i].flop) * gain, 1.0e-9);
+                if (!_options.consoleSilence)
+                    std::cout << "\rEstimate sensitivity of INT8 layers: " << ToString(100.0 * (i + 1) / layers.size(), 1) << "% " << std::flush;
+            }
+            if (!_options.consoleSilence)
+                std::cout << std::endl;
+            std::stable_sort(layers.begin(), layers.end(), [](const SearchLayer& a, const SearchLayer& b) { return a.score > b.score; });
+
+            size_t reverted = 0;
+            for (; reverted < layers.size() && !passed; ++reverted)
+            {
+                SetQuantizationLevel(network, layers[reverted].name, Synet::TensorType32f);
+                if (!EstimateNetwork(network, passed, error, time))
+                    return false;
+                if (!_options.consoleSilence)
+                    std::cout << "Revert layer '" << layers[reverted].name << "' to FP32: error = " << ToString(error, 6)
+                        << ", speedup = " << ToString(_referenceTime / time, 2) << std::endl;
+            }
+            if (!passed)
+            {
+                std::cout << "Can't reach required precision even with all layers in FP32!" << std::endl;
+                return false;
+            }
+            if (!_options.consoleSilence)
+                std::cout << "Mixed precision search: " << reverted << " of " << layers.size() << " layers are reverted to FP32." << std::endl;
+            return true;
+        }
+
         bool PerformQuntization()
         {
             if (!_options.consoleSilence)
@@ -385,11 +699,14 @@ namespace Test
                 EltwiseToAdd(layer, network().layers());
                 ScaleToConvolution(layer);
                 QuantizeConvolution(layer);
+                QuantizeDeconvolution(layer);
                 QuantizeInnerProduct(layer);
                 HighlightGlobalPooling(layer);
                 SetConcatCan8i(layer);
             }
             network().quantization().method() = _quant().method();
+            if (_quant().mixedPrecision() && !SearchMixedPrecision(network()))
+                return false;
             Floats bin;
             Synet::OptimizerParamHolder param;
             Synet::Optimizer optimizer(param());
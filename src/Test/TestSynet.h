@@ -95,7 +95,13 @@ namespace Test
                             return false;
                     }
                 }
+#ifndef SYNET_TEST_SHARED_WEIGHT
                 _net.CompactWeight();
+#endif
+#ifdef SYNET_TEST_MEMORY_PLANNING_CHECK
+                if (!InitCheck(model, weight))
+                    return false;
+#endif
                 _lower = param.lower();
                 _upper = param.upper();
                 _synetMemoryUsage = _net.MemoryUsage();
@@ -105,6 +111,26 @@ namespace Test
             return false;
         }
 
+        virtual bool Clone(const Network & network)
+        {
+#ifdef SYNET_TEST_SHARED_WEIGHT
+            TEST_PERF_BLOCK(Type());
+            const SynetNetwork & origin = (const SynetNetwork &)network;
+            if (!origin._net.Clone(_net))
+                return false;
+            _regionThreshold = origin._regionThreshold;
+            _trans = origin._trans;
+            _sort = origin._sort;
+            _lower = origin._lower;
+            _upper = origin._upper;
+            _epsilon = origin._epsilon;
+            _synetMemoryUsage = _net.MemoryUsage();
+            return true;
+#else
+            return false;
+#endif
+        }
+
         virtual void Free()
         {
             Network::Free();
@@ -121,6 +147,9 @@ namespace Test
                 TEST_PERF_BLOCK_FLOP(Type(), _net.Flop());
                 _net.Forward();
             }
+#ifdef SYNET_TEST_MEMORY_PLANNING_CHECK
+            CheckPlanning();
+#endif
             SetOutput();
             return _output;
         }
@@ -150,6 +179,9 @@ namespace Test
     private:
         typedef Synet::Network<float> Net;
         Net _net;
+#ifdef SYNET_TEST_MEMORY_PLANNING_CHECK
+        Net _check;
+#endif
         bool _trans, _sort;
         Floats _lower, _upper;
         size_t _synetMemoryUsage;
@@ -159,6 +191,19 @@ namespace Test
         {
             Synet::Options synOpt;
             synOpt.performanceLog = (Synet::Options::PerfomanceLog)options.performanceLog;
+#if defined(SYNET_TEST_MEMORY_PLANNING) || defined(SYNET_TEST_MEMORY_PLANNING_CHECK)
+            synOpt.memoryPlanning = true;
+#endif
+#ifdef SYNET_TEST_INTER_OP_THREADS
+            synOpt.interOpThreads = SYNET_TEST_INTER_OP_THREADS;
+#endif
+#ifdef SYNET_TEST_RESHAPE_CACHE
+            synOpt.reshapeCacheSize = SYNET_TEST_RESHAPE_CACHE;
+#endif
+#ifdef SYNET_TEST_TUNING_CACHE
+            synOpt.autoTuning = true;
+            synOpt.tuningCache = SYNET_TEST_TUNING_CACHE;
+#endif
 
 #ifdef SYNET_TEST_MEMORY_LOAD
             std::ifstream mifs(model, std::ios::binary);
@@ -184,11 +229,47 @@ namespace Test
             wifs.close();
 
             return _net.Load(mdata.data(), msize, wdata.data(), wsize, synOpt);
+#elif defined(SYNET_TEST_MEMORY_MAPPED)
+            return _net.LoadMapped(model, weight, synOpt);
 #else
             return _net.Load(model, weight, synOpt);
 #endif
         }
 
+#ifdef SYNET_TEST_MEMORY_PLANNING_CHECK
+        bool InitCheck(const String & model, const String & weight)
+        {
+            if (!_check.Load(model, weight))
+                return false;
+            Strings srcNames, dstNames;
+            Shapes srcShapes;
+            for (size_t i = 0; i < _net.Src().size(); ++i)
+            {
+                srcNames.push_back(_net.Src()[i]->Name());
+                srcShapes.push_back(_net.Src()[i]->Shape());
+            }
+            for (size_t i = 0; i < _net.Back().size(); ++i)
+                dstNames.push_back(_net.Back()[i]->Param().name());
+            return _check.Reshape(srcNames, srcShapes, dstNames);
+        }
+
+        void CheckPlanning()
+        {
+            if (_check.Src().size() != _net.Src().size())
+                return;
+            for (size_t i = 0; i < _net.Src().size(); ++i)
+                memcpy(_check.Src()[i]->RawCpuData(), _net.Src()[i]->RawCpuData(), _net.Src()[i]->RawSize());
+            _check.Forward();
+            for (size_t i = 0; i < _net.Dst().size() && i < _check.Dst().size(); ++i)
+            {
+                const Net::Tensor & planned = *_net.Dst()[i], & naive = *_check.Dst()[i];
+                if (planned.Shape() != naive.Shape() || planned.RawSize() != naive.RawSize() ||
+                    memcmp(planned.RawCpuData(), naive.RawCpuData(), planned.RawSize()) != 0)
+                    std::cout << "Error! Memory planning changes output '" << planned.Name() << "' !" << std::endl;
+            }
+        }
+#endif
+
         void SetInput(const Tensors& x)
         {
             assert(x.size() == _net.Src().size());